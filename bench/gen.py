@@ -0,0 +1,65 @@
+"""
+Synthetic BP programs for the benchmarks in this directory.
+
+    python3 bench/gen.py <shape> <n> > program.src
+
+lex     n copies of a block that uses every kind of token
+if      n nested if statements
+for     n nested for loops
+paren   an expression in n nested parentheses
+mixed   n nested if statements and for loops, alternating
+"""
+import sys
+
+
+def lex(n):
+    out = ["program lexing is",
+           "variable total : integer;",
+           "variable ratio : float;",
+           "variable name : string;",
+           "variable flag : bool;",
+           "variable values : integer[10];",
+           "begin"]
+    for i in range(n):
+        out += ["// Block %d" % i,
+                "total := (total + %d) * 3 - values[%d] / 2;" % (i % 97, i % 7),
+                "ratio := ratio * 1.25 + 0.5; /* a block /* nested */ comment */",
+                "name := \"identifier_%d\";" % i,
+                "flag := (total >= 100) != (ratio < 2.5);",
+                "flag := not flag;",
+                "if (flag == true) then values[%d] := total; else total := 0; end if;" % (i % 10)]
+    out.append("end program.")
+    return out
+
+
+def nested(kind, n):
+    out = ["program deep is",
+           "variable x : integer;",
+           "variable i : integer;",
+           "begin"]
+    if kind == "if":
+        out += ["if (x < %d) then x := x + 1;" % (i % 7) for i in range(n)]
+        out.append("x := 0;")
+        out += ["end if;"] * n
+    elif kind == "for":
+        out += ["for (i := 0; i < %d)" % (i % 7) for i in range(n)]
+        out.append("x := x + 1;")
+        out += ["end for;"] * n
+    elif kind == "paren":
+        out.append("x := " + "(x + " * n + "1" + ")" * n + ";")
+    else:
+        out += ["if (((1)) < x) then x := ((x)); else" if i % 2 else "for (i := 0; (i) < 3)" for i in range(n)]
+        out.append("x := 0;")
+        out += ["end if;" if i % 2 else "end for;" for i in reversed(range(n))]
+    out.append("end program.")
+    return out
+
+
+SHAPES = {"lex": lex}
+for kind in ("if", "for", "paren", "mixed"):
+    SHAPES[kind] = lambda n, kind=kind: nested(kind, n)
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3 or sys.argv[1] not in SHAPES:
+        sys.exit("Usage: gen.py <%s> <n>" % "|".join(SHAPES))
+    print("\n".join(SHAPES[sys.argv[1]](int(sys.argv[2]))))
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "compiler.h"
+#include "io.h"
+#include "lexer.h"
+
+/*
+ * Lexes a file to EOF and reports the throughput.
+ *
+ *     bin/lex_bench <file name> [rounds]
+ */
+
+static double now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <file name> [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    int rounds = argc > 2 ? atoi(argv[2]) : 1;
+    source_T* src = bp_open_source(argv[1]);
+    long tokens = 0;
+    double start = now();
+
+    for (int round = 0; round < rounds; round++)
+    {
+        bp_compiler_T* compiler = init_compiler(argv[1], NULL);
+        lexer_T* lexer = init_lexer(compiler, src->contents, src->length);
+
+        while (lexer_get_next_token(lexer)->type != T_EOF)
+        {
+            tokens++;
+        }
+
+        free(lexer);
+        free_compiler(compiler);
+    }
+
+    double seconds = (now() - start) / rounds;
+    printf("%zu bytes, %ld tokens: %.4f s per round, %.1f MB/s\n", src->length, tokens / rounds, seconds, src->length / seconds / 1e6);
+    bp_close_source(src);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "intern.h"
+#include "scope.h"
+
+/*
+ * Declares n names in a scope, looks each of them up and exits the
+ * scope, for n = 10, 1000 and 100000, about 4M declarations per n.
+ *
+ *     bin/scope_bench
+ */
+
+#define BENCH_OPS 4000000
+
+static double now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int main()
+{
+    int sizes[] = {10, 1000, 100000};
+    char name[32];
+    InternPool pool = {0};
+    Symbol sym = {0};
+
+    for (int s = 0; s < 3; s++)
+    {
+        int n = sizes[s];
+        int rounds = BENCH_OPS / n;
+        const InternedString** keys = malloc(n * sizeof(InternedString*));
+        for (int i = 0; i < n; i++)
+        {
+            snprintf(name, sizeof(name), "ident_%d", i);
+            keys[i] = intern_cstr(&pool, name);
+        }
+
+        ScopeStack* scopes = init_scope_stack();
+        double insert = 0, lookup = 0, pop = 0;
+        long hits = 0;
+
+        for (int round = 0; round < rounds; round++)
+        {
+            double start = now();
+            push_scope(scopes);
+            for (int i = 0; i < n; i++)
+            {
+                set_symbol(scopes, keys[i], sym, scopes->depth);
+            }
+
+            double inserted = now();
+            for (int i = 0; i < n; i++)
+            {
+                hits += lookup_symbol(scopes, keys[i]) != NULL;
+            }
+
+            double looked_up = now();
+            pop_scope(scopes);
+            double exited = now();
+
+            insert += inserted - start;
+            lookup += looked_up - inserted;
+            pop += exited - looked_up;
+        }
+
+        double ops = (double) rounds * n;
+        printf("n=%6d insert %6.1f ns/op  lookup %6.1f ns/op  exit %9.1f ns/scope (%ld hits)\n",
+            n, insert / ops * 1e9, lookup / ops * 1e9, pop / rounds * 1e9, hits);
+
+        free_scope_stack(scopes);
+        free(keys);
+    }
+
+    free_intern_pool(&pool);
+    return 0;
+}
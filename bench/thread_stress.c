@@ -0,0 +1,118 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bp.h"
+#include "io.h"
+
+/*
+ * Compiles every file from many threads at once and checks that each
+ * bitcode and diagnostics output matches the one compiled alone first.
+ *
+ *     bin/thread_stress <threads> <rounds> <file names>
+ */
+
+#define MAX_THREADS 64
+
+typedef struct
+{
+    const char* name;
+    source_T* src;
+    char* bitcode;
+    size_t bitcode_length;
+    char* diagnostics;
+} StressFile;
+
+static StressFile* files;
+static int file_count;
+static int rounds;
+
+/*
+ * Compile file the same way it was compiled alone, 1 if the output differs
+ */
+static int check_file(StressFile* file)
+{
+    char* bitcode;
+    size_t bitcode_length;
+    char* diagnostics;
+    bp_compile_to_memory(file->src->contents, file->src->length, file->name, &bitcode, &bitcode_length, &diagnostics);
+
+    int differs = (bitcode == NULL) != (file->bitcode == NULL) ||
+        bitcode_length != file->bitcode_length ||
+        (bitcode != NULL && memcmp(bitcode, file->bitcode, bitcode_length) != 0) ||
+        strcmp(diagnostics, file->diagnostics) != 0;
+
+    free(bitcode);
+    free(diagnostics);
+    return differs;
+}
+
+static void* stress_thread(void* arg)
+{
+    long thread = (long) arg;
+    long failures = 0;
+
+    // Each thread starts on a different file, so different programs overlap
+    for (int round = 0; round < rounds; round++)
+    {
+        for (int i = 0; i < file_count; i++)
+        {
+            StressFile* file = &files[(i + thread) % file_count];
+            if (check_file(file))
+            {
+                fprintf(stderr, "Thread %ld, round %d: the output of `%s` differs\n", thread, round, file->name);
+                failures++;
+            }
+        }
+    }
+    return (void*) failures;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 4 || atoi(argv[1]) < 1 || atoi(argv[1]) > MAX_THREADS)
+    {
+        fprintf(stderr, "Usage: %s <threads, 1 to %d> <rounds> <file names>\n", argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    int thread_count = atoi(argv[1]);
+    rounds = atoi(argv[2]);
+    file_count = argc - 3;
+    files = calloc(file_count, sizeof(StressFile));
+
+    for (int i = 0; i < file_count; i++)
+    {
+        StressFile* file = &files[i];
+        file->name = argv[i + 3];
+        file->src = bp_open_source(file->name);
+        bp_compile_to_memory(file->src->contents, file->src->length, file->name, &file->bitcode, &file->bitcode_length, &file->diagnostics);
+    }
+
+    pthread_t threads[MAX_THREADS];
+    for (long t = 0; t < thread_count; t++)
+    {
+        pthread_create(&threads[t], NULL, stress_thread, (void*) t);
+    }
+
+    long failures = 0;
+    for (int t = 0; t < thread_count; t++)
+    {
+        void* thread_failures;
+        pthread_join(threads[t], &thread_failures);
+        failures += (long) thread_failures;
+    }
+
+    long compiles = (long) thread_count * rounds * file_count;
+    printf("%ld of %ld compilations matched the single-threaded output\n", compiles - failures, compiles);
+
+    for (int i = 0; i < file_count; i++)
+    {
+        free(files[i].bitcode);
+        free(files[i].diagnostics);
+        bp_close_source(files[i].src);
+    }
+    free(files);
+    return failures != 0;
+}
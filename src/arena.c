@@ -0,0 +1,80 @@
+#include "include/arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+static ArenaChunk* init_chunk(size_t size)
+{
+    ArenaChunk* chunk = malloc(sizeof(struct ArenaChunk) + size);
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+arena_T* init_arena()
+{
+    arena_T* arena = calloc(1, sizeof(struct ARENA_STRUCT));
+    arena->head = init_chunk(ARENA_CHUNK_SIZE);
+    arena->current = arena->head;
+    return arena;
+}
+
+/*
+ * Zeroed block of size bytes.
+ * Every chunk after current is empty, so moving forward
+ * reuses a chunk left over from an earlier reset before growing the list.
+ */
+void* arena_alloc(arena_T* arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+
+    ArenaChunk* chunk = arena->current;
+    while (chunk->used + size > chunk->size)
+    {
+        if (chunk->next == NULL)
+        {
+            chunk->next = init_chunk(size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE);
+        }
+        chunk = chunk->next;
+        chunk->used = 0;
+    }
+
+    void* ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->current = chunk;
+    return memset(ptr, 0, size);
+}
+
+ArenaMark arena_mark(arena_T* arena)
+{
+    ArenaMark mark = { arena->current, arena->current->used };
+    return mark;
+}
+
+void arena_release(arena_T* arena, ArenaMark mark)
+{
+    arena->current = mark.chunk;
+    arena->current->used = mark.used;
+}
+
+void arena_reset(arena_T* arena)
+{
+    arena->current = arena->head;
+    arena->current->used = 0;
+}
+
+void free_arena(arena_T* arena)
+{
+    if (arena != NULL)
+    {
+        ArenaChunk* chunk = arena->head;
+        while (chunk != NULL)
+        {
+            ArenaChunk* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        free(arena);
+    }
+}
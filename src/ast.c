@@ -0,0 +1,80 @@
+#include "include/ast.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+ast_T* init_ast()
+{
+    ast_T* ast = calloc(1, sizeof(struct AST_STRUCT));
+    ast->capacity = AST_INITIAL_CAPACITY;
+    ast->nodes = malloc(ast->capacity * sizeof(Node));
+    ast->count = 1;
+    ast->strings = init_arena();
+    return ast;
+}
+
+void free_ast(ast_T* ast)
+{
+    if (ast != NULL)
+    {
+        free(ast->nodes);
+        free_arena(ast->strings);
+        free(ast);
+    }
+}
+
+/*
+ * Add a node with every field cleared, doubling the pool when it is full.
+ * Pointers to nodes are only valid until the next add.
+ */
+NodeIndex ast_add(ast_T* ast, NodeKind kind)
+{
+    if (ast->count == ast->capacity)
+    {
+        ast->capacity *= 2;
+        ast->nodes = realloc(ast->nodes, ast->capacity * sizeof(Node));
+    }
+
+    Node* node = &ast->nodes[ast->count];
+    memset(node, 0, sizeof(Node));
+    node->kind = kind;
+    return ast->count++;
+}
+
+/*
+ * Keep a copy of str for as long as the nodes referring to it
+ */
+const char* ast_copy_string(ast_T* ast, const char* str)
+{
+    size_t length = strlen(str) + 1;
+    char* copy = arena_alloc(ast->strings, length);
+    memcpy(copy, str, length);
+    return copy;
+}
+
+AstMark ast_mark(ast_T* ast)
+{
+    AstMark mark = { ast->count, arena_mark(ast->strings) };
+    return mark;
+}
+
+void ast_release(ast_T* ast, AstMark mark)
+{
+    ast->count = mark.count;
+    arena_release(ast->strings, mark.strings);
+}
+
+Value init_value()
+{
+    Value val = { TC_UNKNOWN, 0, false, false, NO_NODE };
+    return val;
+}
+
+/*
+ * Value of a use of sym, before any index is applied
+ */
+Value init_value_from_symbol(Symbol* sym)
+{
+    Value val = { sym->type, sym->arr_size, sym->is_arr, false, NO_NODE };
+    return val;
+}
@@ -1,5 +1,17 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <llvm-c/Analysis.h>
+#include <llvm-c/Error.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Orc.h>
 
 #include "include/bp.h"
 #include "include/io.h"
@@ -7,32 +19,935 @@
 #include "include/token.h"
 #include "include/parser.h"
 #include "include/semantic.h"
+#include "include/compiler.h"
+#include "include/codegen.h"
+#include "include/error.h"
+#include "include/custom.h"
+#include "include/cache.h"
+#include "include/server.h"
 
 
-void bp_compile(char* src, const char* name, bool parser_flag, bool table_flag, bool jit_flag)
+/*
+ * Handle of a program JIT'd by ORC, the JIT owns its code
+ */
+struct BP_PROGRAM_STRUCT
 {
-    set_file_name(name);
-    Semantic* sem = init_semantic_analyzer();
-    lexer_T* lexer = init_lexer(src, sem);
-    parser_T* parser = init_parser(lexer, sem, parser_flag, table_flag, jit_flag);
+    LLVMOrcLLJITRef jit;
+    bp_main_T main;
+};
 
-    if(output_bitcode(parser))
+/*
+ * Link object into the executable output with the system C compiler,
+ * $CC or cc
+ */
+static bool link_executable(bp_compiler_T* compiler, const char* object, const char* output)
+{
+    const char* cc = getenv("CC");
+    if (cc == NULL || cc[0] == '\0')
+    {
+        cc = "cc";
+    }
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        execlp(cc, cc, object, "-o", output, (char*) NULL);
+        _exit(127);
+    }
+
+    int status = 0;
+    if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        report_diagnostic(compiler, "%s:\nERROR: Could not link `%s` with `%s`\n", compiler->file_name, output, cc);
+        return false;
+    }
+    return true;
+}
+
+bool bp_compile(const char* src, size_t length, const char* name, const char* output, bool parser_flag, bool table_flag, bool jit_flag, bool trace_flag, int jobs, const char* opt_level, bp_output_T output_kind, const char* cpu)
+{
+    // Debug output needs a real compilation. Procedures emitted on threads
+    // come out in another order, so -j is part of the key, like -O.
+    // Only bitcode is cached.
+    char key[BP_CACHE_KEY_SIZE];
+    bool cached = !parser_flag && !table_flag && !jit_flag && !trace_flag && output_kind == BP_OUTPUT_BITCODE && cache_enabled();
+    if (cached)
+    {
+        char* options = cache_options(jobs, opt_level, cpu);
+        cache_key(src, length, options, key);
+        free(options);
+        if (cache_fetch(key, output))
+        {
+            printf("Successfully generate code.\n");
+            return true;
+        }
+    }
+
+    // An executable is linked from an object in the temporary directory
+    char* object = NULL;
+    if (output_kind == BP_OUTPUT_EXECUTABLE)
+    {
+        const char* tmp = getenv("TMPDIR");
+        object = concatf("%s/bp-XXXXXX.o", tmp != NULL && tmp[0] != '\0' ? tmp : "/tmp");
+        int fd = mkstemps(object, 2);
+        if (fd < 0)
+        {
+            printf("Could not create a temporary object file: %s\n", strerror(errno));
+            free(object);
+            return false;
+        }
+        close(fd);
+    }
+
+    bp_compiler_T* compiler = init_compiler(name, object != NULL ? object : output);
+    compiler->opt_level = opt_level;
+    compiler->output_kind = output_kind;
+    compiler->cpu = cpu;
+    Semantic* sem = init_semantic_analyzer(compiler);
+    lexer_T* lexer = init_lexer(compiler, src, length);
+    parser_T* parser = init_parser(compiler, lexer, sem, parser_flag, table_flag, jit_flag, trace_flag, jobs);
+
+    // The temporary object is removed on every path, output_bitcode never exits
+    bool status = output_bitcode(parser) && (object == NULL || link_executable(compiler, object, output));
+    if (status)
     {
         printf("Successfully generate code.\n");
+
+        // A hit prints nothing, so only programs without diagnostics are cached
+        if (cached && compiler->diagnostic_count == 0)
+        {
+            cache_store(key, output);
+        }
+    }
+
+    if (object != NULL)
+    {
+        unlink(object);
+        free(object);
     }
 
     // Cleanup
     free(lexer);
-    free(parser);
-    free(sem);
+    free_parser(parser);
+    free_semantic_analyzer(sem);
+    free_compiler(compiler);
     lexer = NULL;
     parser = NULL;
     sem = NULL;
+    return status;
+}
+
+bool bp_compile_file(const char* filename, bool parser_flag, bool table_flag, bool jit_flag, bool trace_flag, int jobs, const char* opt_level)
+{
+    source_T* src = bp_open_source(filename);
+    bool status = bp_compile(src->contents, src->length, filename, "dist/result.bc", parser_flag, table_flag, jit_flag, trace_flag, jobs, opt_level, BP_OUTPUT_BITCODE, NULL);
+    bp_close_source(src);
+    return status;
+}
+
+/*
+ * Add the message of err to the diagnostics and release it
+ */
+static void report_llvm_error(bp_compiler_T* compiler, LLVMErrorRef err)
+{
+    char* msg = LLVMGetErrorMessage(err);
+    report_diagnostic(compiler, "%s:\nERROR: %s\n", compiler->file_name, msg);
+    LLVMDisposeErrorMessage(msg);
+}
+
+/*
+ * Whether the parsed program has valid IR, and no errors if strict,
+ * status is what parse_program returned. Without strict a program that
+ * does not parse is reported like bp_compile prints it.
+ */
+static bool check_program(bp_compiler_T* compiler, bool status, bool strict)
+{
+    if (!status && !strict)
+    {
+        report_diagnostic(compiler, "Failed to parse the program. Exiting...\n");
+        return false;
+    }
+    if (!status && compiler->error_count == 0)
+    {
+        report_diagnostic(compiler, "%s:\nERROR: Failed to parse the program.\n", compiler->file_name);
+    }
+    if (!status || (strict && compiler->error_count > 0))
+    {
+        return false;
+    }
+
+    char* err = NULL;
+    if (LLVMVerifyModule(compiler->module, LLVMReturnStatusAction, &err))
+    {
+        report_diagnostic(compiler, "%s:\nERROR: %s\n", compiler->file_name, err);
+        status = false;
+    }
+    LLVMDisposeMessage(err);
+    return status;
+}
+
+/*
+ * New JIT whose main dylib resolves the C library of the process.
+ * It generates code for machine, which it takes, or the host if it is NULL.
+ */
+static LLVMErrorRef create_jit(LLVMOrcLLJITRef* jit, LLVMTargetMachineRef machine)
+{
+    LLVMOrcLLJITBuilderRef builder = NULL;
+    if (machine != NULL)
+    {
+        builder = LLVMOrcCreateLLJITBuilder();
+        LLVMOrcLLJITBuilderSetJITTargetMachineBuilder(builder, LLVMOrcJITTargetMachineBuilderCreateFromTargetMachine(machine));
+    }
+    LLVMErrorRef err = LLVMOrcCreateLLJIT(jit, builder);
+    if (err)
+    {
+        return err;
+    }
+
+    // The runtime calls into the C library of the process
+    LLVMOrcJITDylibRef dylib = LLVMOrcLLJITGetMainJITDylib(*jit);
+    LLVMOrcDefinitionGeneratorRef generator = NULL;
+    err = LLVMOrcCreateDynamicLibrarySearchGeneratorForProcess(&generator, LLVMOrcLLJITGetGlobalPrefix(*jit), NULL, NULL);
+    if (!err)
+    {
+        LLVMOrcJITDylibAddGenerator(dylib, generator);
+    }
+
+#ifndef __APPLE__
+    // The runtime reads stdin through the name the macOS C library gives it
+    if (!err)
+    {
+        LLVMJITCSymbolMapPair stdin_symbol = {
+            LLVMOrcLLJITMangleAndIntern(*jit, "__stdinp"),
+            { (LLVMOrcExecutorAddress) (uintptr_t) &stdin, { LLVMJITSymbolGenericFlagsExported, 0 } }
+        };
+        err = LLVMOrcJITDylibDefine(dylib, LLVMOrcAbsoluteSymbols(&stdin_symbol, 1));
+    }
+#endif
+
+    if (err)
+    {
+        LLVMConsumeError(LLVMOrcDisposeLLJIT(*jit));
+        *jit = NULL;
+    }
+    return err;
+}
+
+/*
+ * Add module to the main dylib of jit, which takes it
+ */
+static LLVMErrorRef add_jit_module(LLVMOrcLLJITRef jit, LLVMModuleRef module, LLVMOrcThreadSafeContextRef context)
+{
+    // The runtime module was written for another target, build for the host
+    LLVMSetTarget(module, LLVMOrcLLJITGetTripleString(jit));
+    LLVMSetDataLayout(module, LLVMOrcLLJITGetDataLayoutStr(jit));
+    LLVMOrcThreadSafeModuleRef safe_module = LLVMOrcCreateNewThreadSafeModule(module, context);
+    return LLVMOrcLLJITAddLLVMIRModule(jit, LLVMOrcLLJITGetMainJITDylib(jit), safe_module);
+}
+
+/*
+ * Hand the module of the compilation to a new JIT and compile it,
+ * NULL if it does not link
+ */
+static bp_program_T* jit_program(bp_compiler_T* compiler, LLVMOrcThreadSafeContextRef context)
+{
+    LLVMOrcLLJITRef jit = NULL;
+    LLVMErrorRef err = create_jit(&jit, NULL);
+    if (err)
+    {
+        report_llvm_error(compiler, err);
+        return NULL;
+    }
+
+    err = add_jit_module(jit, compiler->module, context);
+    compiler->module = NULL;
+
+    // Looking up main compiles the module
+    LLVMOrcExecutorAddress main_address = 0;
+    if (!err)
+    {
+        err = LLVMOrcLLJITLookup(jit, &main_address, "main");
+    }
+
+    if (err)
+    {
+        report_llvm_error(compiler, err);
+        LLVMConsumeError(LLVMOrcDisposeLLJIT(jit));
+        return NULL;
+    }
+
+    bp_program_T* program = calloc(1, sizeof(struct BP_PROGRAM_STRUCT));
+    program->jit = jit;
+    program->main = (bp_main_T) (uintptr_t) main_address;
+    return program;
+}
+
+bp_program_T* bp_load_program(const char* src, size_t length, const char* name, char** diagnostics)
+{
+    initialize_llvm();
+    bp_compiler_T* compiler = init_compiler(name, NULL);
+    compiler->collect_diagnostics = true;
+    Semantic* sem = init_semantic_analyzer(compiler);
+    lexer_T* lexer = init_lexer(compiler, src, length);
+    parser_T* parser = init_parser(compiler, lexer, sem, false, false, false, false, 1);
+
+    // The module is built in the context the JIT takes it with
+    LLVMOrcThreadSafeContextRef context = LLVMOrcCreateNewThreadSafeContext();
+    codegen_context(compiler, LLVMOrcThreadSafeContextGetContext(context));
+
+    bool status = check_program(compiler, parse_program(parser), true);
+
+    bp_program_T* program = NULL;
+    if (status)
+    {
+        program = jit_program(compiler, context);
+    }
+
+    // The thread safe context owns the LLVM context
+    compiler->context = NULL;
+    codegen_dispose_context(compiler);
+    LLVMOrcDisposeThreadSafeContext(context);
+
+    if (diagnostics != NULL)
+    {
+        *diagnostics = take_diagnostics(compiler);
+    }
+
+    free(lexer);
+    free_parser(parser);
+    free_semantic_analyzer(sem);
+    free_compiler(compiler);
+    return program;
 }
 
-void bp_compile_file(const char* filename, bool parser_flag, bool table_flag, bool jit_flag)
+bool bp_compile_to_memory(const char* src, size_t length, const char* name, char** bitcode, size_t* bitcode_length, char** diagnostics)
 {
-    char* src = bp_read_file(filename);
-    bp_compile(src, filename, parser_flag, table_flag, jit_flag);
-    free(src);
-}
\ No newline at end of file
+    return bp_compile_bitcode(src, length, name, true, NULL, NULL, bitcode, bitcode_length, diagnostics);
+}
+
+bool bp_compile_bitcode(const char* src, size_t length, const char* name, bool strict, const char* opt_level, const char* cpu, char** bitcode, size_t* bitcode_length, char** diagnostics)
+{
+    initialize_llvm();
+    bp_compiler_T* compiler = init_compiler(name, NULL);
+    compiler->collect_diagnostics = true;
+    compiler->opt_level = opt_level;
+    compiler->cpu = cpu;
+    Semantic* sem = init_semantic_analyzer(compiler);
+    lexer_T* lexer = init_lexer(compiler, src, length);
+    parser_T* parser = init_parser(compiler, lexer, sem, false, false, false, false, 1);
+
+    codegen_context(compiler, LLVMContextCreate());
+    bool status = check_program(compiler, parse_program(parser), strict);
+
+    // Optimized like output_bitcode does it, with the costs of cpu
+    if (status && opt_level != NULL)
+    {
+        LLVMTargetMachineRef machine = codegen_target_machine(compiler);
+        status = machine != NULL && codegen_optimize(compiler, compiler->module, machine);
+        if (machine != NULL)
+        {
+            LLVMDisposeTargetMachine(machine);
+        }
+    }
+
+    *bitcode = NULL;
+    *bitcode_length = 0;
+    if (status)
+    {
+        LLVMMemoryBufferRef buffer = LLVMWriteBitcodeToMemoryBuffer(compiler->module);
+        *bitcode_length = LLVMGetBufferSize(buffer);
+        *bitcode = malloc(*bitcode_length);
+        memcpy(*bitcode, LLVMGetBufferStart(buffer), *bitcode_length);
+        LLVMDisposeMemoryBuffer(buffer);
+    }
+    codegen_dispose_context(compiler);
+
+    *diagnostics = take_diagnostics(compiler);
+    free(lexer);
+    free_parser(parser);
+    free_semantic_analyzer(sem);
+    free_compiler(compiler);
+    return status;
+}
+
+bp_main_T bp_program_main(bp_program_T* program)
+{
+    return program->main;
+}
+
+void* bp_program_procedure(bp_program_T* program, const char* name)
+{
+    // Identifiers are stored lowercased
+    size_t length = strlen(name);
+    char* lowered = malloc(length + 1);
+    for (size_t i = 0; i <= length; i++)
+    {
+        lowered[i] = tolower((unsigned char) name[i]);
+    }
+
+    LLVMOrcExecutorAddress address = 0;
+    LLVMErrorRef err = LLVMOrcLLJITLookup(program->jit, &address, lowered);
+    free(lowered);
+    if (err)
+    {
+        LLVMConsumeError(err);
+        return NULL;
+    }
+    return (void*) (uintptr_t) address;
+}
+
+void bp_free_program(bp_program_T* program)
+{
+    if (program != NULL)
+    {
+        LLVMConsumeError(LLVMOrcDisposeLLJIT(program->jit));
+        free(program);
+    }
+}
+
+/*
+ * Called through the stub of a procedure that could not be compiled
+ */
+static void lazy_compile_failed()
+{
+    fprintf(stderr, "Failed to compile a procedure of the program\n");
+    exit(1);
+}
+
+/*
+ * Optimizer of a run, applied to each module when the JIT compiles it
+ */
+typedef struct RunOptimizer
+{
+    bp_compiler_T* compiler;
+    LLVMTargetMachineRef machine;
+} RunOptimizer;
+
+static LLVMErrorRef optimize_jit_module(void* arg, LLVMModuleRef module)
+{
+    RunOptimizer* optimizer = arg;
+    if (!codegen_optimize(optimizer->compiler, module, optimizer->machine))
+    {
+        return LLVMCreateStringError("Could not optimize the program");
+    }
+    return LLVMErrorSuccess;
+}
+
+static LLVMErrorRef optimize_transform(void* arg, LLVMOrcThreadSafeModuleRef* module, LLVMOrcMaterializationResponsibilityRef responsibility)
+{
+    return LLVMOrcThreadSafeModuleWithModuleDo(*module, optimize_jit_module, arg);
+}
+
+/*
+ * JIT the program and run its body. Each procedure is defined as
+ * <name>.body in a module of its own, and <name> is a lazy reexport
+ * of it, so a procedure is only compiled the first time it is called.
+ */
+static bool run_program(bp_compiler_T* compiler, codegen_T* cg, LLVMOrcThreadSafeContextRef context)
+{
+    // The code is generated for compiler->cpu and optimized with its costs
+    LLVMTargetMachineRef machine = codegen_target_machine(compiler);
+    if (machine == NULL)
+    {
+        return false;
+    }
+    RunOptimizer optimizer = { compiler, compiler->opt_level != NULL ? codegen_target_machine(compiler) : NULL };
+
+    LLVMOrcLLJITRef jit = NULL;
+    LLVMOrcLazyCallThroughManagerRef call_through = NULL;
+    LLVMOrcIndirectStubsManagerRef stubs = NULL;
+    LLVMErrorRef err = create_jit(&jit, machine);
+    if (!err && optimizer.machine != NULL)
+    {
+        // Procedures are only optimized when they are compiled
+        LLVMOrcIRTransformLayerSetTransform(LLVMOrcLLJITGetIRTransformLayer(jit), optimize_transform, &optimizer);
+    }
+    if (!err)
+    {
+        const char* triple = LLVMOrcLLJITGetTripleString(jit);
+        stubs = LLVMOrcCreateLocalIndirectStubsManager(triple);
+        err = LLVMOrcCreateLocalLazyCallThroughManager(triple, LLVMOrcLLJITGetExecutionSession(jit),
+            (LLVMOrcJITTargetAddress) (uintptr_t) lazy_compile_failed, &call_through);
+    }
+    if (!err)
+    {
+        err = add_jit_module(jit, compiler->module, context);
+        compiler->module = NULL;
+    }
+
+    LLVMOrcCSymbolAliasMapPairs aliases = malloc((cg->unit_count + 1) * sizeof(LLVMOrcCSymbolAliasMapPair));
+    size_t alias_count = 0;
+    for (unsigned int i = 0; i < cg->unit_count && !err; i++)
+    {
+        ProcedureUnit* unit = &cg->units[i];
+        if (unit->module == NULL)
+        {
+            continue;
+        }
+
+        size_t length = 0;
+        const char* name = LLVMGetValueName2(unit->proc.llvm_function, &length);
+        char* body_name = concatf("%s.body", name);
+        aliases[alias_count].Name = LLVMOrcLLJITMangleAndIntern(jit, name);
+        aliases[alias_count].Entry.Name = LLVMOrcLLJITMangleAndIntern(jit, body_name);
+        aliases[alias_count].Entry.Flags = (LLVMJITSymbolFlags) { LLVMJITSymbolGenericFlagsExported | LLVMJITSymbolGenericFlagsCallable, 0 };
+        alias_count++;
+
+        // Calls from the body to itself go straight to the definition
+        LLVMSetValueName2(unit->proc.llvm_function, body_name, strlen(body_name));
+        free(body_name);
+        err = add_jit_module(jit, unit->module, context);
+        unit->module = NULL;
+    }
+
+    // The reexports take the names, which are only released if they are not made
+    LLVMOrcJITDylibRef dylib = jit != NULL ? LLVMOrcLLJITGetMainJITDylib(jit) : NULL;
+    if (!err && alias_count > 0)
+    {
+        err = LLVMOrcJITDylibDefine(dylib, LLVMOrcLazyReexports(call_through, stubs, dylib, aliases, alias_count));
+    }
+    else
+    {
+        for (size_t i = 0; i < alias_count; i++)
+        {
+            LLVMOrcReleaseSymbolStringPoolEntry(aliases[i].Name);
+            LLVMOrcReleaseSymbolStringPoolEntry(aliases[i].Entry.Name);
+        }
+    }
+    free(aliases);
+
+    // Looking up main compiles the module of the program body alone
+    LLVMOrcExecutorAddress main_address = 0;
+    if (!err)
+    {
+        err = LLVMOrcLLJITLookup(jit, &main_address, "main");
+    }
+
+    bool status = !err;
+    if (err)
+    {
+        report_llvm_error(compiler, err);
+    }
+    else
+    {
+        ((bp_main_T) (uintptr_t) main_address)();
+        fflush(stdout);
+    }
+
+    // The call through manager keeps names of the JIT's string pool
+    if (call_through != NULL)
+    {
+        LLVMOrcDisposeLazyCallThroughManager(call_through);
+    }
+    if (stubs != NULL)
+    {
+        LLVMOrcDisposeIndirectStubsManager(stubs);
+    }
+    if (jit != NULL)
+    {
+        LLVMConsumeError(LLVMOrcDisposeLLJIT(jit));
+    }
+    if (optimizer.machine != NULL)
+    {
+        LLVMDisposeTargetMachine(optimizer.machine);
+    }
+    return status;
+}
+
+int bp_run(const char* src, size_t length, const char* name, const char* opt_level, const char* cpu)
+{
+    initialize_llvm();
+    bp_compiler_T* compiler = init_compiler(name, NULL);
+    compiler->opt_level = opt_level;
+    compiler->cpu = cpu != NULL ? cpu : "native";
+    Semantic* sem = init_semantic_analyzer(compiler);
+    lexer_T* lexer = init_lexer(compiler, src, length);
+    parser_T* parser = init_parser(compiler, lexer, sem, false, false, false, false, 1);
+    parser->split_units = true;
+
+    LLVMOrcThreadSafeContextRef context = LLVMOrcCreateNewThreadSafeContext();
+    codegen_context(compiler, LLVMOrcThreadSafeContextGetContext(context));
+    bool status = check_program(compiler, parse_program(parser), true) && run_program(compiler, parser->codegen, context);
+
+    // Modules of procedures that were not handed to the JIT
+    for (unsigned int i = 0; i < parser->codegen->unit_count; i++)
+    {
+        if (parser->codegen->units[i].module != NULL)
+        {
+            LLVMDisposeModule(parser->codegen->units[i].module);
+        }
+    }
+
+    // The thread safe context owns the LLVM context
+    compiler->context = NULL;
+    codegen_dispose_context(compiler);
+    LLVMOrcDisposeThreadSafeContext(context);
+
+    free(lexer);
+    free_parser(parser);
+    free_semantic_analyzer(sem);
+    free_compiler(compiler);
+    return status ? 0 : 1;
+}
+
+/*
+ * Files of a batch, handed out to its workers in order
+ */
+typedef struct BatchQueue
+{
+    char** files;
+    int count;
+    int next;
+    int compiled;
+    int failed;                     // Also counts manifests that could not be read
+    const char* opt_level;          // Of every file, like bp_compile's
+    const char* cpu;
+} BatchQueue;
+
+/*
+ * Process compiling the files of a batch one at a time. It is sent the
+ * index of a file on fd and answers with a BatchResult and the diagnostics,
+ * so a file that crashes the compiler only takes its worker down.
+ */
+typedef struct BatchWorker
+{
+    pid_t pid;
+    int fd;                         // -1 once the worker is stopped
+    int file;                       // Index of the file being compiled
+} BatchWorker;
+
+typedef struct BatchResult
+{
+    uint32_t status;
+    uint32_t diagnostics_length;
+} BatchResult;
+
+/*
+ * Output of a batch input, next to it with .src replaced by .bc
+ */
+static char* batch_output_name(const char* filename)
+{
+    size_t length = strlen(filename);
+    if (length > 4 && strcmp(filename + length - 4, ".src") == 0)
+    {
+        length -= 4;
+    }
+    return concatf("%.*s.bc", (int) length, filename);
+}
+
+/*
+ * Compile one batch input without printing or exiting
+ */
+static bool compile_batch_file(BatchQueue* queue, const char* filename, const char* output, char** diagnostics)
+{
+    source_T* src = bp_try_open_source(filename);
+    if (src == NULL)
+    {
+        *diagnostics = concatf("Could not read file `%s`\n", filename);
+        return false;
+    }
+
+    char* bitcode = NULL;
+    size_t bitcode_length = 0;
+    bool status = compile_cached(src->contents, src->length, filename, true, queue->opt_level, queue->cpu, &bitcode, &bitcode_length, diagnostics);
+    bp_close_source(src);
+
+    if (status)
+    {
+        FILE* file = fopen(output, "wb");
+        if (file == NULL || fwrite(bitcode, 1, bitcode_length, file) != bitcode_length)
+        {
+            char* text = concatf("%sCould not write file `%s`\n", *diagnostics, output);
+            free(*diagnostics);
+            *diagnostics = text;
+            status = false;
+        }
+        if (file != NULL && fclose(file) != 0)
+        {
+            status = false;
+        }
+    }
+    free(bitcode);
+    return status;
+}
+
+/*
+ * Print the status line of a file, with its diagnostics kept together
+ */
+static void report_batch_file(BatchQueue* queue, int file, bool status, const char* diagnostics)
+{
+    const char* filename = queue->files[file];
+    if (status)
+    {
+        char* output = batch_output_name(filename);
+        queue->compiled++;
+        printf("ok      %s -> %s\n", filename, output);
+        free(output);
+    }
+    else
+    {
+        queue->failed++;
+        printf("failed  %s\n%s", filename, diagnostics);
+    }
+    fflush(stdout);
+}
+
+/*
+ * Body of a worker process, compiles the files it is sent until fd closes
+ */
+static void run_batch_worker(BatchQueue* queue, int fd)
+{
+    uint32_t file;
+    while (read_all(fd, &file, sizeof(file)) && file < (uint32_t) queue->count)
+    {
+        const char* filename = queue->files[file];
+        char* output = batch_output_name(filename);
+        char* diagnostics = NULL;
+        bool status = compile_batch_file(queue, filename, output, &diagnostics);
+
+        BatchResult result = { status, strlen(diagnostics) };
+        bool sent = write_all(fd, &result, sizeof(result)) && write_all(fd, diagnostics, result.diagnostics_length);
+        free(diagnostics);
+        free(output);
+        if (!sent)
+        {
+            break;
+        }
+    }
+}
+
+/*
+ * Fork the worker at index of workers, false if it could not be started
+ */
+static bool start_batch_worker(BatchQueue* queue, BatchWorker* workers, int count, int index)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        return false;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // A worker only sees its end of its own socket, so the others
+        // still see theirs close when the batch stops them
+        for (int i = 0; i < count; i++)
+        {
+            if (workers[i].fd >= 0)
+            {
+                close(workers[i].fd);
+            }
+        }
+        close(fds[0]);
+        run_batch_worker(queue, fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    if (pid < 0)
+    {
+        close(fds[0]);
+        return false;
+    }
+    workers[index].pid = pid;
+    workers[index].fd = fds[0];
+    return true;
+}
+
+/*
+ * Stop a worker and wait for it, returns its wait status
+ */
+static int stop_batch_worker(BatchWorker* worker)
+{
+    close(worker->fd);
+    worker->fd = -1;
+
+    int status = 0;
+    while (waitpid(worker->pid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+    return status;
+}
+
+/*
+ * Send the worker the next file, or stop it when there is none left
+ */
+static void next_batch_file(BatchQueue* queue, BatchWorker* worker)
+{
+    uint32_t file = queue->next;
+    if (queue->next < queue->count && write_all(worker->fd, &file, sizeof(file)))
+    {
+        worker->file = queue->next++;
+        return;
+    }
+    stop_batch_worker(worker);
+}
+
+/*
+ * Take the answer of a worker whose socket is readable. If the worker died
+ * instead, its file failed and a new worker takes over.
+ */
+static void finish_batch_file(BatchQueue* queue, BatchWorker* workers, int count, int index)
+{
+    BatchWorker* worker = &workers[index];
+    BatchResult result;
+    if (read_all(worker->fd, &result, sizeof(result)))
+    {
+        char* diagnostics = malloc(result.diagnostics_length + 1);
+        if (read_all(worker->fd, diagnostics, result.diagnostics_length))
+        {
+            diagnostics[result.diagnostics_length] = '\0';
+            report_batch_file(queue, worker->file, result.status, diagnostics);
+            free(diagnostics);
+            next_batch_file(queue, worker);
+            return;
+        }
+        free(diagnostics);
+    }
+
+    int status = stop_batch_worker(worker);
+    char* diagnostics = WIFSIGNALED(status)
+        ? concatf("The compiler crashed on this file (signal %d)\n", WTERMSIG(status))
+        : concatf("The compiler stopped on this file (exit status %d)\n", WEXITSTATUS(status));
+    report_batch_file(queue, worker->file, false, diagnostics);
+    free(diagnostics);
+
+    if (queue->next < queue->count && start_batch_worker(queue, workers, count, index))
+    {
+        next_batch_file(queue, worker);
+    }
+}
+
+/*
+ * Append the files of a batch argument, "@list" names a manifest
+ * with one file per line
+ */
+static void add_batch_input(BatchQueue* queue, int* capacity, const char* arg)
+{
+    source_T* manifest = NULL;
+    const char* name = arg;
+    const char* end = arg + strlen(arg);
+    if (arg[0] == '@')
+    {
+        manifest = bp_try_open_source(arg + 1);
+        if (manifest == NULL)
+        {
+            printf("Could not read file `%s`\n", arg + 1);
+            queue->failed++;
+            return;
+        }
+        name = manifest->contents;
+        end = manifest->contents + manifest->length;
+    }
+
+    while (name < end)
+    {
+        const char* line_end = memchr(name, '\n', end - name);
+        if (line_end == NULL)
+        {
+            line_end = end;
+        }
+
+        // Skip blank lines and trailing whitespace of manifests
+        size_t length = line_end - name;
+        while (length > 0 && isspace((unsigned char) name[length - 1]))
+        {
+            length--;
+        }
+        if (length > 0)
+        {
+            if (queue->count == *capacity)
+            {
+                *capacity = *capacity ? *capacity * 2 : 64;
+                queue->files = realloc(queue->files, *capacity * sizeof(char*));
+            }
+            queue->files[queue->count++] = strndup(name, length);
+        }
+        name = line_end + 1;
+    }
+    bp_close_source(manifest);
+}
+
+int bp_compile_batch(char** inputs, int count, int jobs, const char* opt_level, const char* cpu)
+{
+    BatchQueue queue = { 0 };
+    queue.opt_level = opt_level;
+    queue.cpu = cpu;
+    int capacity = 0;
+    for (int i = 0; i < count; i++)
+    {
+        add_batch_input(&queue, &capacity, inputs[i]);
+    }
+
+    // LLVM and the runtime are set up once, before the workers are forked
+    initialize_llvm();
+    load_runtime();
+    if (jobs < 1)
+    {
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (jobs > queue.count)
+    {
+        jobs = queue.count;
+    }
+
+    BatchWorker* workers = malloc(jobs * sizeof(BatchWorker));
+    struct pollfd* fds = malloc(jobs * sizeof(struct pollfd));
+    for (int i = 0; i < jobs; i++)
+    {
+        workers[i].fd = -1;
+    }
+    for (int i = 0; i < jobs; i++)
+    {
+        if (start_batch_worker(&queue, workers, jobs, i))
+        {
+            next_batch_file(&queue, &workers[i]);
+        }
+    }
+
+    for (;;)
+    {
+        int active = 0;
+        for (int i = 0; i < jobs; i++)
+        {
+            fds[i].fd = workers[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+            active += workers[i].fd >= 0;
+        }
+        if (active == 0)
+        {
+            break;
+        }
+        if (poll(fds, jobs, -1) < 0)
+        {
+            continue;
+        }
+        for (int i = 0; i < jobs; i++)
+        {
+            if (workers[i].fd >= 0 && fds[i].revents != 0)
+            {
+                finish_batch_file(&queue, workers, jobs, i);
+            }
+        }
+    }
+    free(workers);
+    free(fds);
+
+    // Only left over if no worker could be started
+    for (; queue.next < queue.count; queue.next++)
+    {
+        report_batch_file(&queue, queue.next, false, "Could not start a compiler process\n");
+    }
+
+    printf("%d of %d files compiled.\n", queue.compiled, queue.compiled + queue.failed);
+    for (int i = 0; i < queue.count; i++)
+    {
+        free(queue.files[i]);
+    }
+    free(queue.files);
+    return queue.failed;
+}
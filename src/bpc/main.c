@@ -0,0 +1,102 @@
+#include "../include/server.h"
+#include "../include/io.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+
+/*
+ * Thin client of the compile server. It does not load LLVM, so a compilation
+ * on a running server takes milliseconds. Everything else is left to the
+ * bp.out next to it.
+ */
+
+/*
+ * Path of bp.out, next to this program or else on the PATH
+ */
+static char* compiler_path(const char* self)
+{
+    const char* slash = strrchr(self, '/');
+    if (slash == NULL)
+    {
+        return strdup("bp.out");
+    }
+
+    size_t length = slash - self + 1;
+    char* path = malloc(length + sizeof("bp.out"));
+    memcpy(path, self, length);
+    strcpy(path + length, "bp.out");
+    return path;
+}
+
+static void run_compiler(char* argv[])
+{
+    argv[0] = compiler_path(argv[0]);
+    execvp(argv[0], argv);
+    printf("Could not run `%s`\n", argv[0]);
+    exit(1);
+}
+
+/*
+ * Run bp.out on a program already read from stdin
+ */
+static int run_compiler_on(char* argv[], const source_T* src)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return 1;
+    }
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        dup2(fds[0], STDIN_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        run_compiler(argv);
+    }
+
+    close(fds[0]);
+    for (size_t written = 0; written < src->length; )
+    {
+        ssize_t n = write(fds[1], src->contents + written, src->length - written);
+        if (n <= 0)
+        {
+            break;
+        }
+        written += n;
+    }
+    close(fds[1]);
+
+    int status = 1;
+    if (child < 0 || waitpid(child, &status, 0) < 0)
+    {
+        return 1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    // Only plain compilations of one file go to the server
+    if (argc != 2 || (argv[1][0] == '-' && argv[1][1] != '\0'))
+    {
+        run_compiler(argv);
+    }
+
+    int status = 0;
+    source_T* src = bp_open_source(argv[1]);
+    if (!bp_compile_remote(bp_server_socket(), src->contents, src->length, argv[1], "dist/result.bc", &status))
+    {
+        if (strcmp(argv[1], "-") != 0)
+        {
+            run_compiler(argv);
+        }
+        status = run_compiler_on(argv, src);
+    }
+    bp_close_source(src);
+    return status;
+}
@@ -0,0 +1,586 @@
+#include "include/cache.h"
+#include "include/bp.h"
+#include "include/compiler.h"
+#include "include/custom.h"
+#include "include/lexer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/time.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm/Config/llvm-config.h>
+
+// Text of src/runtime.ll, generated by the build
+extern unsigned char src_runtime_ll[];
+extern unsigned int src_runtime_ll_len;
+
+/*
+ * A cached file, ordered by its last use for eviction
+ */
+typedef struct CacheEntry
+{
+    char* path;
+    time_t used;
+    unsigned long long size;
+} CacheEntry;
+
+/*
+ * Directory of the cache, $BP_CACHE_DIR or bp in $XDG_CACHE_HOME or ~/.cache.
+ * NULL if BP_CACHE=0 turns it off.
+ */
+static char* cache_directory()
+{
+    const char* enabled = getenv("BP_CACHE");
+    if (enabled != NULL && (strcmp(enabled, "0") == 0 || strcmp(enabled, "off") == 0))
+    {
+        return NULL;
+    }
+
+    const char* dir = getenv("BP_CACHE_DIR");
+    if (dir != NULL && dir[0] != '\0')
+    {
+        return strdup(dir);
+    }
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    if (xdg != NULL && xdg[0] != '\0')
+    {
+        return concatf("%s/bp", xdg);
+    }
+    const char* home = getenv("HOME");
+    if (home != NULL && home[0] != '\0')
+    {
+        return concatf("%s/.cache/bp", home);
+    }
+    return NULL;
+}
+
+/*
+ * Size limit in bytes, $BP_CACHE_SIZE with an optional K, M or G suffix
+ */
+static unsigned long long cache_limit()
+{
+    const char* text = getenv("BP_CACHE_SIZE");
+    if (text == NULL || text[0] == '\0')
+    {
+        return BP_CACHE_DEFAULT_LIMIT;
+    }
+
+    char* end = NULL;
+    unsigned long long limit = strtoull(text, &end, 10);
+    switch (*end)
+    {
+        case 'k': case 'K': limit <<= 10; break;
+        case 'm': case 'M': limit <<= 20; break;
+        case 'g': case 'G': limit <<= 30; break;
+        default: break;
+    }
+    return limit;
+}
+
+bool cache_enabled()
+{
+    char* dir = cache_directory();
+    bool enabled = dir != NULL;
+    free(dir);
+    return enabled;
+}
+
+static void make_directories(const char* path)
+{
+    char* prefix = strdup(path);
+    for (char* slash = strchr(prefix + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        mkdir(prefix, 0755);
+        *slash = '/';
+    }
+    mkdir(prefix, 0755);
+    free(prefix);
+}
+
+static char* entry_path(const char* dir, const char* key)
+{
+    return concatf("%s/%.2s/%s.bc", dir, key, key);
+}
+
+/*
+ * FNV-1a over 128 bits
+ */
+static void hash_bytes(unsigned __int128* hash, const void* data, size_t length)
+{
+    const unsigned __int128 prime = ((unsigned __int128) 1 << 88) + 0x13b;
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < length; i++)
+    {
+        *hash = (*hash ^ bytes[i]) * prime;
+    }
+}
+
+/*
+ * Every field is preceded by its length so that fields cannot run into each other
+ */
+static void hash_field(unsigned __int128* hash, const void* data, size_t length)
+{
+    hash_bytes(hash, &length, sizeof(length));
+    hash_bytes(hash, data, length);
+}
+
+/*
+ * A token is its type in one byte, followed by its value. Text is
+ * hashed up to its terminator, which ends it as a length would.
+ */
+static void hash_token(unsigned __int128* hash, const Token* token)
+{
+    unsigned char type = token->type;
+    hash_bytes(hash, &type, 1);
+    switch (token->type)
+    {
+        case T_ID:
+            hash_bytes(hash, token->value.idVal->str, token->value.idVal->length + 1);
+            break;
+        case T_STRING:
+            hash_bytes(hash, token->value.stringVal, strlen(token->value.stringVal) + 1);
+            break;
+        case T_NUMBER_INT:
+            hash_bytes(hash, &token->value.intVal, sizeof(token->value.intVal));
+            break;
+        case T_NUMBER_FLOAT:
+            hash_bytes(hash, &token->value.floatVal, sizeof(token->value.floatVal));
+            break;
+        case T_CHAR:
+            hash_bytes(hash, &token->value.charVal, sizeof(token->value.charVal));
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * Hash the tokens of src instead of its text, so that an edit to the
+ * comments or the layout of a program still finds its bitcode.
+ * Sources the lexer complains about are hashed as they are, they are
+ * never cached anyway.
+ */
+static void hash_source(unsigned __int128* hash, const char* src, size_t length)
+{
+    bp_compiler_T* compiler = init_compiler("", "");
+    compiler->collect_diagnostics = true;
+    lexer_T* lexer = init_lexer(compiler, src, length);
+
+    unsigned __int128 tokens = *hash;
+    Token* token;
+    do
+    {
+        token = lexer_get_next_token(lexer);
+        hash_token(&tokens, token);
+    } while (token->type != T_EOF && compiler->diagnostic_count == 0);
+
+    if (compiler->diagnostic_count == 0)
+    {
+        *hash = tokens;
+    }
+    else
+    {
+        hash_field(hash, src, length);
+    }
+    free(lexer);
+    free_compiler(compiler);
+}
+
+/*
+ * Key of a compilation: the compiler and LLVM versions, the runtime,
+ * the target, the options that change the output and the tokens of the source
+ */
+void cache_key(const char* src, size_t length, const char* options, char* key)
+{
+    unsigned __int128 hash = ((unsigned __int128) 0x6c62272e07bb0142ull << 64) | 0x62b821756295c58dull;
+    char* triple = LLVMGetDefaultTargetTriple();
+    hash_field(&hash, BP_COMPILER_VERSION, strlen(BP_COMPILER_VERSION));
+    hash_field(&hash, LLVM_VERSION_STRING, strlen(LLVM_VERSION_STRING));
+    hash_field(&hash, src_runtime_ll, src_runtime_ll_len);
+    hash_field(&hash, triple, strlen(triple));
+    hash_field(&hash, options, strlen(options));
+    hash_source(&hash, src, length);
+    LLVMDisposeMessage(triple);
+    snprintf(key, BP_CACHE_KEY_SIZE, "%016llx%016llx", (unsigned long long) (hash >> 64), (unsigned long long) hash);
+}
+
+static char* read_file(const char* path, size_t* length)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    char* data = NULL;
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        data = malloc(size + 1);
+        if (fread(data, 1, size, file) != (size_t) size)
+        {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(file);
+    *length = size;
+    return data;
+}
+
+static bool write_file(const char* path, const char* data, size_t length)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool status = fwrite(data, 1, length, file) == length;
+    return fclose(file) == 0 && status;
+}
+
+/*
+ * Open and lock the stats file of dir, the lock is released by closing it
+ */
+static int lock_stats(const char* dir, CacheStats* stats)
+{
+    make_directories(dir);
+    char* path = concatf("%s/stats", dir);
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    free(path);
+
+    memset(stats, 0, sizeof(CacheStats));
+    if (fd < 0 || flock(fd, LOCK_EX) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    char text[256];
+    ssize_t n = pread(fd, text, sizeof(text) - 1, 0);
+    text[n > 0 ? n : 0] = '\0';
+    sscanf(text, "hits %llu\nmisses %llu\nfiles %llu\nsize %llu\n", &stats->hits, &stats->misses, &stats->files, &stats->size);
+    return fd;
+}
+
+static void write_stats(int fd, const CacheStats* stats)
+{
+    char text[256];
+    int n = snprintf(text, sizeof(text), "hits %llu\nmisses %llu\nfiles %llu\nsize %llu\n", stats->hits, stats->misses, stats->files, stats->size);
+    if (ftruncate(fd, 0) == 0)
+    {
+        pwrite(fd, text, n, 0);
+    }
+}
+
+static int compare_entries(const void* a, const void* b)
+{
+    time_t left = ((const CacheEntry*) a)->used;
+    time_t right = ((const CacheEntry*) b)->used;
+    return left < right ? -1 : left > right;
+}
+
+/*
+ * Recount the cache from its directory and delete the least recently
+ * used files until it is back under 90% of limit
+ */
+static void evict(const char* dir, CacheStats* stats, unsigned long long limit)
+{
+    CacheEntry* entries = NULL;
+    size_t count = 0, capacity = 0;
+    unsigned long long size = 0;
+
+    DIR* top = opendir(dir);
+    struct dirent* bucket;
+    while (top != NULL && (bucket = readdir(top)) != NULL)
+    {
+        if (strlen(bucket->d_name) != 2 || bucket->d_name[0] == '.')
+        {
+            continue;
+        }
+
+        char* bucket_path = concatf("%s/%s", dir, bucket->d_name);
+        DIR* files = opendir(bucket_path);
+        struct dirent* file;
+        while (files != NULL && (file = readdir(files)) != NULL)
+        {
+            size_t length = strlen(file->d_name);
+            struct stat st;
+            char* path = concatf("%s/%s", bucket_path, file->d_name);
+            if (length < 3 || strcmp(file->d_name + length - 3, ".bc") != 0 || stat(path, &st) != 0)
+            {
+                free(path);
+                continue;
+            }
+
+            if (count == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 256;
+                entries = realloc(entries, capacity * sizeof(CacheEntry));
+            }
+            entries[count++] = (CacheEntry) { path, st.st_mtime, st.st_size };
+            size += st.st_size;
+        }
+        if (files != NULL)
+        {
+            closedir(files);
+        }
+        free(bucket_path);
+    }
+    if (top != NULL)
+    {
+        closedir(top);
+    }
+
+    qsort(entries, count, sizeof(CacheEntry), compare_entries);
+    size_t kept = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (size > limit / 10 * 9 && unlink(entries[i].path) == 0)
+        {
+            size -= entries[i].size;
+            kept--;
+
+            // Fails while the bucket still has files
+            *strrchr(entries[i].path, '/') = '\0';
+            rmdir(entries[i].path);
+        }
+        free(entries[i].path);
+    }
+    free(entries);
+
+    stats->files = kept;
+    stats->size = size;
+}
+
+/*
+ * Cached bitcode of key, NULL on a miss. Counts the hit or miss.
+ */
+char* cache_load(const char* key, size_t* length)
+{
+    char* dir = cache_directory();
+    if (dir == NULL)
+    {
+        return NULL;
+    }
+
+    char* path = entry_path(dir, key);
+    char* data = read_file(path, length);
+    if (data != NULL)
+    {
+        // The modification time is the last use
+        utimes(path, NULL);
+    }
+
+    CacheStats stats;
+    int fd = lock_stats(dir, &stats);
+    if (fd >= 0)
+    {
+        if (data != NULL)
+        {
+            stats.hits++;
+        }
+        else
+        {
+            stats.misses++;
+        }
+        write_stats(fd, &stats);
+        close(fd);
+    }
+
+    free(path);
+    free(dir);
+    return data;
+}
+
+/*
+ * Add the bitcode of key to the cache, evicting old files over the limit
+ */
+void cache_save(const char* key, const char* data, size_t length)
+{
+    char* dir = cache_directory();
+    if (dir == NULL)
+    {
+        return;
+    }
+
+    char* bucket = concatf("%s/%.2s", dir, key);
+    make_directories(bucket);
+    char* path = entry_path(dir, key);
+
+    // Written aside and renamed so that readers never see part of a file
+    char* temp = concatf("%s.XXXXXX", path);
+    int fd = mkstemp(temp);
+    bool written = fd >= 0;
+    for (size_t offset = 0; written && offset < length; )
+    {
+        ssize_t n = write(fd, data + offset, length - offset);
+        written = n > 0;
+        offset += written ? n : 0;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    struct stat old;
+    bool replaced = stat(path, &old) == 0;
+    if (written && rename(temp, path) == 0)
+    {
+        CacheStats stats;
+        int stats_fd = lock_stats(dir, &stats);
+        if (stats_fd >= 0)
+        {
+            stats.files += replaced ? 0 : 1;
+            stats.size += length - (replaced ? old.st_size : 0);
+            unsigned long long limit = cache_limit();
+            if (stats.size > limit)
+            {
+                evict(dir, &stats, limit);
+            }
+            write_stats(stats_fd, &stats);
+            close(stats_fd);
+        }
+    }
+    else
+    {
+        unlink(temp);
+    }
+
+    free(temp);
+    free(path);
+    free(bucket);
+    free(dir);
+}
+
+/*
+ * Copy the cached bitcode of key to output, false on a miss
+ */
+bool cache_fetch(const char* key, const char* output)
+{
+    size_t length = 0;
+    char* data = cache_load(key, &length);
+    bool status = data != NULL && write_file(output, data, length);
+    free(data);
+    return status;
+}
+
+/*
+ * Add the bitcode in file to the cache under key
+ */
+void cache_store(const char* key, const char* file)
+{
+    size_t length = 0;
+    char* data = read_file(file, &length);
+    if (data != NULL)
+    {
+        cache_save(key, data, length);
+    }
+    free(data);
+}
+
+/*
+ * Options of a compilation that change its bitcode, for the cache key.
+ * The optimizations tuned for the host depend on what the host is.
+ */
+char* cache_options(int jobs, const char* opt_level, const char* cpu)
+{
+    char* host_cpu = NULL;
+    char* host_features = NULL;
+    if (cpu != NULL && strcmp(cpu, "native") == 0)
+    {
+        host_cpu = LLVMGetHostCPUName();
+        host_features = LLVMGetHostCPUFeatures();
+    }
+
+    char* options = concatf("%s%s%s%s%s%s%s",
+        jobs > 1 ? "jobs" : "",
+        opt_level != NULL ? " -" : "", opt_level != NULL ? opt_level : "",
+        cpu != NULL ? " -march=" : "", host_cpu != NULL ? host_cpu : cpu != NULL ? cpu : "",
+        host_features != NULL ? " " : "", host_features != NULL ? host_features : "");
+    LLVMDisposeMessage(host_cpu);
+    LLVMDisposeMessage(host_features);
+    return options;
+}
+
+/*
+ * bp_compile_bitcode through the cache. Only programs
+ * without any diagnostics are cached.
+ */
+bool compile_cached(const char* src, size_t length, const char* name, bool strict, const char* opt_level, const char* cpu, char** bitcode, size_t* bitcode_length, char** diagnostics)
+{
+    if (!cache_enabled())
+    {
+        return bp_compile_bitcode(src, length, name, strict, opt_level, cpu, bitcode, bitcode_length, diagnostics);
+    }
+
+    char key[BP_CACHE_KEY_SIZE];
+    char* options = cache_options(1, opt_level, cpu);
+    cache_key(src, length, options, key);
+    free(options);
+    *bitcode = cache_load(key, bitcode_length);
+    if (*bitcode != NULL)
+    {
+        *diagnostics = calloc(1, 1);
+        return true;
+    }
+
+    bool status = bp_compile_bitcode(src, length, name, strict, opt_level, cpu, bitcode, bitcode_length, diagnostics);
+    if (status && (*diagnostics)[0] == '\0')
+    {
+        cache_save(key, *bitcode, *bitcode_length);
+    }
+    return status;
+}
+
+static void format_size(unsigned long long size, char* text)
+{
+    if (size >= (1 << 20))
+    {
+        snprintf(text, 32, "%.1f MB", size / 1048576.0);
+    }
+    else
+    {
+        snprintf(text, 32, "%.1f KB", size / 1024.0);
+    }
+}
+
+void print_cache_stats()
+{
+    char* dir = cache_directory();
+    if (dir == NULL)
+    {
+        printf("The compilation cache is off.\n");
+        return;
+    }
+
+    CacheStats stats;
+    int fd = lock_stats(dir, &stats);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    unsigned long long lookups = stats.hits + stats.misses;
+    printf("Cache directory: %s\n", dir);
+    printf("Hits:            %llu\n", stats.hits);
+    printf("Misses:          %llu\n", stats.misses);
+    printf("Hit rate:        %.1f%%\n", lookups ? 100.0 * stats.hits / lookups : 0.0);
+    printf("Files:           %llu\n", stats.files);
+    char size[32], limit[32];
+    format_size(stats.size, size);
+    format_size(cache_limit(), limit);
+    printf("Size:            %s of %s\n", size, limit);
+    free(dir);
+}
@@ -0,0 +1,208 @@
+#include "include/server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+
+/*
+ * Socket of the compile server, $BP_SERVER or one in a directory only the
+ * user can write to: $XDG_RUNTIME_DIR, else a 0700 directory in /tmp
+ * that bp_serve creates
+ */
+const char* bp_server_socket()
+{
+    static char path[sizeof(((struct sockaddr_un*) NULL)->sun_path)];
+    const char* env = getenv("BP_SERVER");
+    if (env != NULL && env[0] != '\0')
+    {
+        return env;
+    }
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir != NULL && runtime_dir[0] != '\0')
+    {
+        snprintf(path, sizeof(path), "%s/bp.sock", runtime_dir);
+    }
+    else
+    {
+        snprintf(path, sizeof(path), "/tmp/bp-%u/bp.sock", (unsigned int) getuid());
+    }
+    return path;
+}
+
+/*
+ * Whether the process at the other end of fd runs as this user.
+ * Sources and bitcode are only exchanged with such a peer.
+ */
+bool peer_is_user(int fd)
+{
+#ifdef SO_PEERCRED
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 && credentials.uid == getuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+/*
+ * Read exactly length bytes, false on EOF or error
+ */
+bool read_all(int fd, void* buffer, size_t length)
+{
+    char* data = buffer;
+    while (length > 0)
+    {
+        ssize_t n = read(fd, data, length);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+/*
+ * Write all of buffer, false if the peer went away
+ */
+bool write_all(int fd, const void* buffer, size_t length)
+{
+    const char* data = buffer;
+    while (length > 0)
+    {
+        // A client that went away must not kill the server with SIGPIPE
+        ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+/*
+ * Socket address of path, false if it does not fit
+ */
+bool socket_address(const char* path, struct sockaddr_un* address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path))
+    {
+        return false;
+    }
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+/*
+ * Connect to the server at path, -1 if none of this user is listening
+ */
+int connect_server(const char* path)
+{
+    struct sockaddr_un address;
+    if (!socket_address(path, &address))
+    {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    // Anyone can listen on a path another user can write to
+    if (fd >= 0 && !peer_is_user(fd))
+    {
+        fprintf(stderr, "Ignoring the server on `%s`, it runs as another user\n", path);
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/*
+ * Compile src on the server at socket_path and write its bitcode to output.
+ * Returns false if no server answered, the caller then compiles locally.
+ * Otherwise *exit_status is the status for bp.out.
+ */
+bool bp_compile_remote(const char* socket_path, const char* src, size_t length, const char* name, const char* output, int* exit_status)
+{
+    if (length > BP_SERVER_MAX_SOURCE)
+    {
+        return false;
+    }
+    int fd = connect_server(socket_path);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    ServerRequest request = { BP_SERVER_MAGIC, strlen(name), length };
+    ServerResponse response;
+    bool received = write_all(fd, &request, sizeof(request))
+        && write_all(fd, name, request.name_length)
+        && write_all(fd, src, length)
+        && read_all(fd, &response, sizeof(response));
+
+    // Nothing is printed before the whole response is in, a server
+    // that crashes on the program leaves it to the local compiler
+    char* diagnostics = NULL;
+    char* bitcode = NULL;
+    if (received)
+    {
+        diagnostics = malloc(response.diagnostics_length + 1);
+        bitcode = malloc(response.bitcode_length + 1);
+        received = read_all(fd, diagnostics, response.diagnostics_length) && read_all(fd, bitcode, response.bitcode_length);
+        diagnostics[response.diagnostics_length] = '\0';
+    }
+    close(fd);
+
+    if (received)
+    {
+        printf("%s", diagnostics);
+        bool written = response.status;
+        if (written)
+        {
+            // A failed write fails the compilation, as in output_bitcode
+            FILE* file = fopen(output, "wb");
+            written = file != NULL && fwrite(bitcode, 1, response.bitcode_length, file) == response.bitcode_length;
+            if (file != NULL && fclose(file) != 0)
+            {
+                written = false;
+            }
+            if (!written)
+            {
+                fprintf(stderr, "error writing bitcode to file, skipping\n");
+            }
+        }
+        if (written)
+        {
+            printf("Successfully generate code.\n");
+        }
+        *exit_status = written ? 0 : 1;
+    }
+
+    free(diagnostics);
+    free(bitcode);
+    return received;
+}
@@ -0,0 +1,1301 @@
+#include "include/codegen.h"
+#include "include/error.h"
+#include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <pthread.h>
+
+// Text of src/runtime.ll, generated by the build
+extern unsigned char src_runtime_ll[];
+extern unsigned int src_runtime_ll_len;
+
+
+/*
+ * Code generator constructor
+ */
+codegen_T* init_codegen(bp_compiler_T* compiler, Semantic* sem, ast_T* ast)
+{
+    codegen_T* cg = calloc(1, sizeof(struct CODEGEN_STRUCT));
+    cg->compiler = compiler;
+    cg->sem = sem;
+    cg->ast = ast;
+    cg->unit_arena = init_arena();
+    return cg;
+}
+
+void free_codegen(codegen_T* cg)
+{
+    if (cg != NULL)
+    {
+        free(cg->blocks);
+        free(cg->tasks);
+        free(cg->values);
+        free(cg->units);
+        free_arena(cg->unit_arena);
+        free(cg->stamps);
+        free(cg->slots);
+        free(cg);
+    }
+}
+
+/*
+ * Types and builder of the compilation in context, which the compilation owns
+ * until codegen_dispose_context unless it hands it over first
+ */
+void codegen_context(bp_compiler_T* compiler, LLVMContextRef context)
+{
+    compiler->context = context;
+
+    // Types in context
+    compiler->int32_type = LLVMInt32TypeInContext(compiler->context);
+    compiler->int8_type = LLVMInt8TypeInContext(compiler->context);
+    compiler->int1_type = LLVMInt1TypeInContext(compiler->context);
+    compiler->float_type = LLVMFloatTypeInContext(compiler->context);
+
+    // Create builder
+    compiler->builder = LLVMCreateBuilderInContext(compiler->context);
+}
+
+void codegen_dispose_context(bp_compiler_T* compiler)
+{
+    LLVMDisposeBuilder(compiler->builder);
+    LLVMDisposeModule(compiler->module);
+    LLVMContextDispose(compiler->context);
+}
+
+/*
+ * The runtime as bitcode, parsed from its text once per process
+ * since reading bitcode is much cheaper
+ */
+static LLVMMemoryBufferRef runtime_bitcode;
+static pthread_once_t runtime_once = PTHREAD_ONCE_INIT;
+
+static void parse_runtime()
+{
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMModuleRef runtime = NULL;
+    LLVMMemoryBufferRef buffer = LLVMCreateMemoryBufferWithMemoryRangeCopy((const char*) src_runtime_ll, src_runtime_ll_len, "runtime.ll");
+    LLVMParseIRInContext(context, buffer, &runtime, NULL);
+    runtime_bitcode = LLVMWriteBitcodeToMemoryBuffer(runtime);
+    LLVMDisposeModule(runtime);
+    LLVMContextDispose(context);
+}
+
+void load_runtime()
+{
+    pthread_once(&runtime_once, parse_runtime);
+}
+
+/*
+ * Create the module for the program, linked with the runtime
+ */
+void codegen_module(bp_compiler_T* compiler, const char* name)
+{
+    // The program is emitted into the runtime module, built into the compiler,
+    // with the program identifier
+    load_runtime();
+    LLVMParseBitcodeInContext2(compiler->context, runtime_bitcode, &compiler->module);
+    LLVMSetModuleIdentifier(compiler->module, name, strlen(name));
+}
+
+/*
+ * Main entry function, the program body is emitted into it
+ */
+LLVMValueRef codegen_main_function(bp_compiler_T* compiler)
+{
+    LLVMTypeRef return_type   = LLVMVoidTypeInContext(compiler->context);
+    LLVMTypeRef main_func_type = LLVMFunctionType(return_type, NULL, 0, false);
+    LLVMValueRef func = LLVMAddFunction(compiler->module, "main", main_func_type);
+    LLVMSetLinkage(func, LLVMExternalLinkage);
+    return func;
+}
+
+/*
+ * Add the function of a procedure, its body is emitted once parsed
+ */
+void codegen_procedure_declaration(bp_compiler_T* compiler, Symbol* decl)
+{
+    int param_cnt = params_size(decl);
+    int counter = 0;
+    LLVMTypeRef* param_types = (LLVMTypeRef *) malloc(sizeof(LLVMTypeRef) * param_cnt);
+
+    Symbol* current_param;
+    LLVMTypeRef ty;
+    for (counter = 0; counter < param_cnt; counter++)
+    {
+        current_param = get_nth_param(decl, counter);
+        ty = create_llvm_type(compiler, current_param->type);
+        if (current_param->is_arr)
+        {
+            param_types[counter] = LLVMArrayType(ty, current_param->arr_size);
+        }
+        else
+        {
+            param_types[counter] = ty;
+        }
+    }
+
+
+    LLVMTypeRef ft = LLVMFunctionType(create_llvm_type(compiler, decl->type), param_types, param_cnt, false);
+    LLVMValueRef func = LLVMAddFunction(compiler->module, decl->id, ft);
+    LLVMSetLinkage(func, LLVMExternalLinkage);
+
+    // Set parameter names
+    for (counter = 0; counter < param_cnt; counter++)
+    {
+        current_param = get_nth_param(decl, counter);
+        LLVMValueRef param = LLVMGetParam(func, counter);
+        LLVMSetValueName2(param, current_param->id, strlen(current_param->id));
+    }
+
+    decl->llvm_function = func;
+}
+
+/*
+ * Global variable allocation
+ */
+void codegen_global_variable(bp_compiler_T* compiler, Symbol* decl)
+{
+    LLVMTypeRef ty = create_llvm_type(compiler, decl->type);
+    if (decl->is_arr)
+    {
+        ty = LLVMArrayType(ty, decl->arr_size);
+    }
+
+    // Default value
+    LLVMValueRef init_val = LLVMConstNull(ty);
+    LLVMValueRef address = LLVMAddGlobal(compiler->module, ty, decl->id);
+    LLVMSetInitializer(address, init_val);
+    decl->llvm_address = address;
+}
+
+/*
+ * Capture the body of proc, with the procedure's scope still current.
+ * The nodes of the body are first to the end of the tree.
+ */
+ProcedureUnit* capture_procedure_unit(codegen_T* cg, Symbol* proc, NodeIndex first, NodeIndex body)
+{
+    ScopeStack* scopes = cg->sem->scopes;
+    Node* nodes = cg->ast->nodes;
+
+    if (cg->unit_count == cg->unit_capacity)
+    {
+        cg->unit_capacity = cg->unit_capacity == 0 ? CODEGEN_UNITS_INITIAL_CAPACITY : cg->unit_capacity * 2;
+        cg->units = realloc(cg->units, cg->unit_capacity * sizeof(ProcedureUnit));
+    }
+    if (cg->stamp_capacity < scopes->count)
+    {
+        unsigned int capacity = scopes->count * 2;
+        cg->stamps = realloc(cg->stamps, capacity * sizeof(unsigned int));
+        cg->slots = realloc(cg->slots, capacity * sizeof(unsigned int));
+        memset(cg->stamps + cg->stamp_capacity, 0, (capacity - cg->stamp_capacity) * sizeof(unsigned int));
+        cg->stamp_capacity = capacity;
+    }
+
+    ProcedureUnit* unit = &cg->units[cg->unit_count++];
+    memset(unit, 0, sizeof(ProcedureUnit));
+    unit->proc = *proc;
+    unit->body = body;
+    unit->mark = arena_mark(cg->unit_arena);
+    cg->capture_stamp++;
+
+    // Give a slot to the parameters and variables declared in the current scope,
+    // then to every other binding a name of the body refers to
+    for (unsigned int i = scopes->scope_starts[scopes->depth]; i < scopes->count; i++)
+    {
+        if (scopes->bindings[i].depth == scopes->depth && scopes->bindings[i].symbol.stype == ST_VARIABLE)
+        {
+            cg->stamps[i] = cg->capture_stamp;
+            cg->slots[i] = unit->symbol_count++;
+        }
+    }
+    unit->local_count = unit->symbol_count;
+
+    for (NodeIndex n = first; n < cg->ast->count; n++)
+    {
+        if (nodes[n].kind == NODE_NAME || nodes[n].kind == NODE_DESTINATION || nodes[n].kind == NODE_CALL)
+        {
+            unsigned int i = (Binding*) ((char*) nodes[n].data.symbol - offsetof(Binding, symbol)) - scopes->bindings;
+            if (cg->stamps[i] != cg->capture_stamp)
+            {
+                cg->stamps[i] = cg->capture_stamp;
+                cg->slots[i] = unit->symbol_count++;
+            }
+        }
+    }
+
+    // Copy the symbols and point the body at the copies
+    unit->symbols = arena_alloc(cg->unit_arena, unit->symbol_count * sizeof(Symbol));
+    for (unsigned int i = scopes->scope_starts[scopes->depth]; i < scopes->count; i++)
+    {
+        if (cg->stamps[i] == cg->capture_stamp)
+        {
+            unit->symbols[cg->slots[i]] = scopes->bindings[i].symbol;
+        }
+    }
+
+    for (NodeIndex n = first; n < cg->ast->count; n++)
+    {
+        if (nodes[n].kind == NODE_NAME || nodes[n].kind == NODE_DESTINATION || nodes[n].kind == NODE_CALL)
+        {
+            Symbol* sym = nodes[n].data.symbol;
+            unsigned int slot = cg->slots[(Binding*) ((char*) sym - offsetof(Binding, symbol)) - scopes->bindings];
+            if (slot >= unit->local_count)
+            {
+                unit->symbols[slot] = *sym;
+
+                // Variables of an enclosing procedure are not globals,
+                // their addresses can only be used from the main module
+                if (sym->stype == ST_VARIABLE && (sym->llvm_address == NULL || LLVMIsAGlobalVariable(sym->llvm_address) == NULL))
+                {
+                    unit->serial = true;
+                }
+            }
+            nodes[n].data.symbol = &unit->symbols[slot];
+        }
+    }
+
+    return unit;
+}
+
+/*
+ * Drop the last unit captured, once it is emitted
+ */
+void drop_procedure_unit(codegen_T* cg)
+{
+    cg->unit_count--;
+    arena_release(cg->unit_arena, cg->units[cg->unit_count].mark);
+}
+
+/*
+ * Emit the body of a procedure into its function.
+ * Returns false if the function does not verify, which is when a path
+ * through it has no return.
+ */
+bool codegen_procedure_unit(codegen_T* cg, ProcedureUnit* unit)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    LLVMValueRef func = unit->proc.llvm_function;
+    cg->func = func;
+
+    // Set entrypoint for function
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(compiler->context, func, "entry");
+    LLVMPositionBuilderAtEnd(compiler->builder, entry);
+
+    // Allocate address for parameters and variables declared in the procedure
+    int counter = 0;
+
+    for (unsigned int i = 0; i < unit->local_count; i++)
+    {
+        Symbol* current_entry = &unit->symbols[i];
+
+        LLVMTypeRef ty = NULL;
+        if (current_entry->is_arr)
+        {
+            ty = LLVMArrayType(create_llvm_type(compiler, current_entry->type), current_entry->arr_size);
+            current_entry->llvm_address = LLVMBuildArrayAlloca(compiler->builder, ty, NULL, current_entry->id);
+        }
+        else
+        {
+            ty = create_llvm_type(compiler, current_entry->type);
+            current_entry->llvm_address = LLVMBuildAlloca(compiler->builder, ty, current_entry->id);
+        }
+    }
+
+
+    // Store argument values in allocated addresses
+    int param_cnt = params_size(&unit->proc);
+    LLVMValueRef current_param = NULL;
+
+    for (counter = 0; counter < param_cnt; counter++)
+    {
+        current_param = LLVMGetParam(func, counter);
+        // Get current symbol from the locals since
+        // parameter list is not up to date with symbol table
+        Symbol* declared = get_nth_param(&unit->proc, counter);
+        Symbol* param = NULL;
+        for (unsigned int i = 0; i < unit->local_count && param == NULL; i++)
+        {
+            if (unit->symbols[i].name == declared->name)
+            {
+                param = &unit->symbols[i];
+            }
+        }
+
+        // Store parameter value in address. Arrays are passed by value,
+        // so an array parameter is stored whole into its local array
+        LLVMBuildStore(compiler->builder, current_param, param->llvm_address);
+    }
+
+    codegen_statements(cg, unit->body);
+
+    // Verify that function has a return value
+    return !LLVMVerifyFunction(func, LLVMReturnStatusAction);
+}
+
+/*
+ * Emit every kept unit on jobs threads, each into its own context,
+ * and link what they emitted into compiler->module.
+ * Returns false, after reporting it, if the units could not be linked.
+ */
+bool codegen_procedure_units(codegen_T* cg, int jobs)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    if (cg->unit_count == 0)
+    {
+        return true;
+    }
+    if ((unsigned int) jobs > cg->unit_count)
+    {
+        jobs = cg->unit_count;
+    }
+
+    // Workers start from the declarations of the module emitted so far,
+    // which include the functions of the units
+    LLVMModuleRef decls = codegen_declarations(compiler, compiler->module);
+    LLVMMemoryBufferRef header = LLVMWriteBitcodeToMemoryBuffer(decls);
+    LLVMDisposeModule(decls);
+    unsigned int next_unit = 0;
+
+    CodegenWorker* workers = calloc(jobs, sizeof(CodegenWorker));
+    pthread_t* threads = malloc(jobs * sizeof(pthread_t));
+    for (int i = 0; i < jobs; i++)
+    {
+        workers[i].parent = cg;
+        workers[i].header = header;
+        workers[i].next_unit = &next_unit;
+    }
+
+    // Only the threads that started take units. If none did,
+    // this thread emits them all.
+    int started = 0;
+    while (started < jobs && pthread_create(&threads[started], NULL, codegen_worker, &workers[started]) == 0)
+    {
+        started++;
+    }
+    if (started == 0)
+    {
+        codegen_worker(&workers[0]);
+    }
+
+    // Linking replaces declarations the workers read names from,
+    // so it waits for all of them
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    bool linked = true;
+    for (int i = 0; i < (started > 0 ? started : 1); i++)
+    {
+        LLVMModuleRef module = NULL;
+        if (workers[i].result == NULL)
+        {
+            report_diagnostic(compiler, "%s:\nERROR: Failed to read the module in code generation thread %d\n", compiler->file_name, i);
+            linked = false;
+            continue;
+        }
+        if (LLVMParseBitcodeInContext2(compiler->context, workers[i].result, &module) || LLVMLinkModules2(compiler->module, module))
+        {
+            report_diagnostic(compiler, "%s:\nERROR: Failed to link the procedures of code generation thread %d\n", compiler->file_name, i);
+            linked = false;
+        }
+        LLVMDisposeMemoryBuffer(workers[i].result);
+    }
+
+    LLVMDisposeMemoryBuffer(header);
+    free(workers);
+    free(threads);
+    return linked;
+}
+
+/*
+ * Declare value of the main module in module, under the same name
+ */
+static LLVMValueRef declare_value(LLVMModuleRef module, LLVMValueRef value)
+{
+    size_t length = 0;
+    const char* name = LLVMGetValueName2(value, &length);
+    if (LLVMIsAFunction(value) != NULL)
+    {
+        LLVMValueRef func = LLVMGetNamedFunction(module, name);
+        return func != NULL ? func : LLVMAddFunction(module, name, LLVMGlobalGetValueType(value));
+    }
+    LLVMValueRef global = LLVMGetNamedGlobal(module, name);
+    return global != NULL ? global : LLVMAddGlobal(module, LLVMGlobalGetValueType(value), name);
+}
+
+/*
+ * Emit every kept unit into a module of its own, in the context of
+ * compiler->module, so each procedure can be compiled on its own.
+ * A unit's module only declares the names its body refers to.
+ */
+void codegen_split_units(codegen_T* cg)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    LLVMModuleRef main_module = compiler->module;
+    LLVMValueRef bounds_error = LLVMGetNamedFunction(main_module, "outOfBoundsError");
+    size_t length = 0;
+
+    for (unsigned int i = 0; i < cg->unit_count; i++)
+    {
+        ProcedureUnit* unit = &cg->units[i];
+        const char* name = LLVMGetValueName2(unit->proc.llvm_function, &length);
+        LLVMModuleRef module = LLVMModuleCreateWithNameInContext(name, compiler->context);
+        LLVMSetDataLayout(module, LLVMGetDataLayoutStr(main_module));
+        LLVMSetTarget(module, LLVMGetTarget(main_module));
+
+        // Array accesses call the runtime without a symbol of the body
+        declare_value(module, bounds_error);
+        declare_value(module, unit->proc.llvm_function);
+        for (unsigned int j = unit->local_count; j < unit->symbol_count; j++)
+        {
+            Symbol* sym = &unit->symbols[j];
+            if (sym->llvm_function != NULL)
+            {
+                declare_value(module, sym->llvm_function);
+            }
+            if (sym->llvm_address != NULL)
+            {
+                declare_value(module, sym->llvm_address);
+            }
+        }
+
+        compiler->module = module;
+        rebind_procedure_unit(compiler, unit);
+        unit->valid = codegen_procedure_unit(cg, unit);
+        unit->module = module;
+    }
+    compiler->module = main_module;
+}
+
+void* codegen_worker(void* arg)
+{
+    CodegenWorker* worker = arg;
+    codegen_T* parent = worker->parent;
+
+    // The worker's own LLVM state, its symbols are the parent's copies
+    bp_compiler_T* compiler = init_compiler(parent->compiler->file_name, NULL);
+    codegen_context(compiler, LLVMContextCreate());
+
+    // A worker that cannot read the declarations takes no units and
+    // leaves result NULL, the units go to the other workers
+    if (LLVMParseBitcodeInContext2(compiler->context, worker->header, &compiler->module))
+    {
+        compiler->module = NULL;
+        codegen_dispose_context(compiler);
+        free_compiler(compiler);
+        return NULL;
+    }
+
+    codegen_T* cg = init_codegen(compiler, NULL, parent->ast);
+    unsigned int i;
+    while ((i = __atomic_fetch_add(worker->next_unit, 1, __ATOMIC_RELAXED)) < parent->unit_count)
+    {
+        ProcedureUnit* unit = &parent->units[i];
+        rebind_procedure_unit(compiler, unit);
+        unit->valid = codegen_procedure_unit(cg, unit);
+    }
+
+    worker->result = LLVMWriteBitcodeToMemoryBuffer(compiler->module);
+    free_codegen(cg);
+    codegen_dispose_context(compiler);
+    free_compiler(compiler);
+    return NULL;
+}
+
+/*
+ * Module declaring every function and visible global of module,
+ * so linking what is emitted into it only adds the new definitions
+ */
+LLVMModuleRef codegen_declarations(bp_compiler_T* compiler, LLVMModuleRef module)
+{
+    LLVMModuleRef decls = LLVMModuleCreateWithNameInContext("declarations", compiler->context);
+    LLVMSetDataLayout(decls, LLVMGetDataLayoutStr(module));
+    LLVMSetTarget(decls, LLVMGetTarget(module));
+    size_t length = 0;
+
+    for (LLVMValueRef func = LLVMGetFirstFunction(module); func != NULL; func = LLVMGetNextFunction(func))
+    {
+        LLVMValueRef decl = LLVMAddFunction(decls, LLVMGetValueName2(func, &length), LLVMGlobalGetValueType(func));
+        for (unsigned int i = 0; i < LLVMCountParams(func); i++)
+        {
+            const char* name = LLVMGetValueName2(LLVMGetParam(func, i), &length);
+            LLVMSetValueName2(LLVMGetParam(decl, i), name, length);
+        }
+    }
+
+    for (LLVMValueRef global = LLVMGetFirstGlobal(module); global != NULL; global = LLVMGetNextGlobal(global))
+    {
+        LLVMLinkage linkage = LLVMGetLinkage(global);
+        if (linkage != LLVMPrivateLinkage && linkage != LLVMInternalLinkage)
+        {
+            LLVMAddGlobal(decls, LLVMGlobalGetValueType(global), LLVMGetValueName2(global, &length));
+        }
+    }
+
+    return decls;
+}
+
+/*
+ * Point the copies of names declared outside the procedure
+ * at the declarations of the same names in compiler->module
+ */
+void rebind_procedure_unit(bp_compiler_T* compiler, ProcedureUnit* unit)
+{
+    unit->proc.llvm_function = rebind_value(compiler, unit->proc.llvm_function);
+    for (unsigned int i = unit->local_count; i < unit->symbol_count; i++)
+    {
+        unit->symbols[i].llvm_function = rebind_value(compiler, unit->symbols[i].llvm_function);
+        unit->symbols[i].llvm_address = rebind_value(compiler, unit->symbols[i].llvm_address);
+    }
+}
+
+LLVMValueRef rebind_value(bp_compiler_T* compiler, LLVMValueRef value)
+{
+    if (value == NULL)
+    {
+        return NULL;
+    }
+
+    size_t length = 0;
+    const char* name = LLVMGetValueName2(value, &length);
+    if (LLVMIsAFunction(value) != NULL)
+    {
+        return LLVMGetNamedFunction(compiler->module, name);
+    }
+    return LLVMGetNamedGlobal(compiler->module, name);
+}
+
+void codegen_program_body(codegen_T* cg, Symbol* proc, NodeIndex body)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    cg->func = proc->llvm_function;
+
+    // Set main entrypoint
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "entry");
+    LLVMPositionBuilderAtEnd(compiler->builder, entry);
+
+    codegen_statements(cg, body);
+
+    // End main function, return 0
+    LLVMBuildRetVoid(compiler->builder);
+}
+
+/*
+ * Target machine of the host's triple for compiler->cpu, generic if it is
+ * not set. NULL if the target is missing, which is reported.
+ */
+LLVMTargetMachineRef codegen_target_machine(bp_compiler_T* compiler)
+{
+    char* triple = LLVMGetDefaultTargetTriple();
+    LLVMTargetRef target;
+    char* err = NULL;
+    if (LLVMGetTargetFromTriple(triple, &target, &err))
+    {
+        report_diagnostic(compiler, "%s:\nERROR: %s\n", compiler->file_name, err);
+        LLVMDisposeMessage(err);
+        LLVMDisposeMessage(triple);
+        return NULL;
+    }
+
+    // -march=native tunes for the host CPU and uses all of its features
+    const char* cpu = compiler->cpu != NULL ? compiler->cpu : "generic";
+    char* host_cpu = NULL;
+    char* host_features = NULL;
+    if (strcmp(cpu, "native") == 0)
+    {
+        host_cpu = LLVMGetHostCPUName();
+        host_features = LLVMGetHostCPUFeatures();
+        cpu = host_cpu;
+    }
+
+    // Objects are position independent, C compilers link executables as PIE
+    LLVMTargetMachineRef machine = LLVMCreateTargetMachine(target, triple, cpu,
+        host_features != NULL ? host_features : "", LLVMCodeGenLevelDefault, LLVMRelocPIC, LLVMCodeModelDefault);
+    LLVMDisposeMessage(triple);
+    LLVMDisposeMessage(host_cpu);
+    LLVMDisposeMessage(host_features);
+    return machine;
+}
+
+/*
+ * Run the new pass manager's default pipeline for compiler->opt_level on
+ * module, tuned with the costs of machine. The module is verified.
+ * Returns false if the pipeline could not run, the module is then unchanged.
+ */
+bool codegen_optimize(bp_compiler_T* compiler, LLVMModuleRef module, LLVMTargetMachineRef machine)
+{
+    const char* level = compiler->opt_level;
+    if (level == NULL || strcmp(level, "O0") == 0)
+    {
+        return true;
+    }
+
+    // Unroll and vectorize like clang does, from O2 on, but only
+    // unroll at Oz
+    bool unroll = strcmp(level, "O1") != 0;
+    bool vectorize = unroll && strcmp(level, "Oz") != 0;
+    LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+    LLVMPassBuilderOptionsSetLoopUnrolling(options, unroll);
+    LLVMPassBuilderOptionsSetLoopVectorization(options, vectorize);
+    LLVMPassBuilderOptionsSetSLPVectorization(options, vectorize);
+
+    char* pipeline = concatf("default<%s>", level);
+    LLVMErrorRef err = LLVMRunPasses(module, pipeline, machine, options);
+    free(pipeline);
+    LLVMDisposePassBuilderOptions(options);
+
+    if (err)
+    {
+        char* msg = LLVMGetErrorMessage(err);
+        report_diagnostic(compiler, "%s:\nERROR: %s\n", compiler->file_name, msg);
+        LLVMDisposeErrorMessage(msg);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Compile the module to a native object at path for machine.
+ * The program body becomes an int main returning 0, so the object
+ * links into an executable with the C library.
+ */
+bool codegen_emit_object(bp_compiler_T* compiler, LLVMTargetMachineRef machine, const char* path)
+{
+    LLVMModuleRef module = compiler->module;
+
+    // The runtime module was written for macOS, build for the machine
+    char* triple = LLVMGetTargetMachineTriple(machine);
+    LLVMTargetDataRef data = LLVMCreateTargetDataLayout(machine);
+    char* layout = LLVMCopyStringRepOfTargetData(data);
+    LLVMSetTarget(module, triple);
+    LLVMSetDataLayout(module, layout);
+    LLVMDisposeMessage(layout);
+    LLVMDisposeTargetData(data);
+    LLVMDisposeMessage(triple);
+
+#ifndef __APPLE__
+    // The runtime reads stdin through the name the macOS C library gives it
+    LLVMValueRef stdinp = LLVMGetNamedGlobal(module, "__stdinp");
+    if (stdinp != NULL && LLVMGetNamedGlobal(module, "stdin") == NULL)
+    {
+        LLVMSetValueName2(stdinp, "stdin", strlen("stdin"));
+    }
+#endif
+
+    // "program" is a keyword, so no procedure has the name of the body
+    LLVMValueRef body = LLVMGetNamedFunction(module, "main");
+    LLVMSetValueName2(body, "program.body", strlen("program.body"));
+    LLVMSetLinkage(body, LLVMInternalLinkage);
+
+    LLVMTypeRef main_type = LLVMFunctionType(compiler->int32_type, NULL, 0, false);
+    LLVMValueRef main_func = LLVMAddFunction(module, "main", main_type);
+    LLVMBuilderRef builder = LLVMCreateBuilderInContext(compiler->context);
+    LLVMPositionBuilderAtEnd(builder, LLVMAppendBasicBlockInContext(compiler->context, main_func, "entry"));
+    LLVMBuildCall2(builder, LLVMGlobalGetValueType(body), body, NULL, 0, "");
+    LLVMBuildRet(builder, LLVMConstInt(compiler->int32_type, 0, false));
+    LLVMDisposeBuilder(builder);
+
+    char* err = NULL;
+    if (LLVMTargetMachineEmitToFile(machine, module, (char*) path, LLVMObjectFile, &err))
+    {
+        report_diagnostic(compiler, "%s:\nERROR: Could not write `%s`: %s\n", compiler->file_name, path, err);
+        LLVMDisposeMessage(err);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Emit a list of statements. The lists of nested if and loop statements
+ * are emitted here too, their blocks sit on cg->blocks.
+ */
+void codegen_statements(codegen_T* cg, NodeIndex list)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    Node* nodes = cg->ast->nodes;
+    unsigned int base = cg->block_count;
+
+    push_gen_block(cg, NO_NODE, list, NULL, NULL);
+    while (cg->block_count > base)
+    {
+        GenBlock* block = &cg->blocks[cg->block_count - 1];
+        if (block->next != NO_NODE)
+        {
+            NodeIndex stmt = block->next;
+            block->next = nodes[stmt].next;
+            codegen_statement(cg, stmt);
+            continue;
+        }
+
+        // The list of the block has ended
+        if (block->node == NO_NODE)
+        {
+            cg->block_count--;
+        }
+        else if (nodes[block->node].kind == NODE_IF)
+        {
+            // Merge the then or else block into merge_block if there wasn't a return
+            if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(compiler->builder)) == NULL)
+            {
+                LLVMBuildBr(compiler->builder, block->merge_block);
+            }
+
+            if (!block->in_else)
+            {
+                // An if without else has an empty else list
+                LLVMPositionBuilderAtEnd(compiler->builder, block->next_block);
+                block->in_else = true;
+                block->next = nodes[block->node].extra;
+                continue;
+            }
+
+            LLVMPositionBuilderAtEnd(compiler->builder, block->merge_block);
+            cg->block_count--;
+        }
+        else
+        {
+            // Go back to the header to check the condition
+            if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(compiler->builder)) == NULL)
+            {
+                LLVMBuildBr(compiler->builder, block->next_block);
+            }
+
+            LLVMPositionBuilderAtEnd(compiler->builder, block->merge_block);
+            cg->block_count--;
+        }
+    }
+}
+
+/*
+ * Emit a statement, an if or loop statement is only emitted up to its
+ * statement list, which is left on cg->blocks
+ */
+void codegen_statement(codegen_T* cg, NodeIndex stmt)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    Node* node = &cg->ast->nodes[stmt];
+    LLVMValueRef zero_val = LLVMConstInt(compiler->int1_type, 0, true);
+
+    switch (node->kind)
+    {
+        case NODE_ASSIGN:
+            codegen_assignment(cg, stmt);
+            break;
+        case NODE_IF:
+        {
+            LLVMValueRef exp = codegen_conversion(cg, codegen_expression(cg, node->lhs), node->lhs_conv);
+            LLVMValueRef if_cond = LLVMBuildICmp(compiler->builder, LLVMIntNE, exp, zero_val, "");
+
+            LLVMBasicBlockRef if_then_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "ifThen");
+            LLVMBasicBlockRef else_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "ifElse");
+            LLVMBasicBlockRef merge_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "ifMerge");
+
+            LLVMBuildCondBr(compiler->builder, if_cond, if_then_block, else_block);
+            LLVMPositionBuilderAtEnd(compiler->builder, if_then_block);
+
+            push_gen_block(cg, stmt, node->rhs, else_block, merge_block);
+            break;
+        }
+        case NODE_LOOP:
+        {
+            codegen_assignment(cg, node->lhs);
+
+            LLVMBasicBlockRef loop_header_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "loop_head");
+            LLVMBasicBlockRef loop_body_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "loop_body");
+            LLVMBasicBlockRef loop_merge_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "loop_merge");
+
+            LLVMBuildBr(compiler->builder, loop_header_block);
+            LLVMPositionBuilderAtEnd(compiler->builder, loop_header_block);
+
+            LLVMValueRef exp = codegen_conversion(cg, codegen_expression(cg, node->rhs), node->rhs_conv);
+            LLVMValueRef loop_cond = LLVMBuildICmp(compiler->builder, LLVMIntNE, exp, zero_val, "");
+            LLVMBuildCondBr(compiler->builder, loop_cond, loop_body_block, loop_merge_block);
+
+            // Loop body
+            LLVMPositionBuilderAtEnd(compiler->builder, loop_body_block);
+
+            push_gen_block(cg, stmt, node->extra, loop_header_block, loop_merge_block);
+            break;
+        }
+        case NODE_RETURN:
+        {
+            LLVMValueRef exp = codegen_conversion(cg, codegen_expression(cg, node->lhs), node->lhs_conv);
+            LLVMBuildRet(compiler->builder, exp);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void codegen_assignment(codegen_T* cg, NodeIndex stmt)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    Node* node = &cg->ast->nodes[stmt];
+    LLVMValueRef dest = codegen_expression(cg, node->lhs);
+    LLVMValueRef exp = codegen_conversion(cg, codegen_expression(cg, node->rhs), node->rhs_conv);
+
+    if (node->is_arr)
+    {
+        // Both dest and exp are unindexed arrays;
+        // Copy element by element
+        array_assignment_codegen(cg, dest, exp, node->type, node->arr_size);
+    }
+    else
+    {
+        LLVMBuildStore(compiler->builder, exp, dest);
+    }
+}
+
+void push_gen_block(codegen_T* cg, NodeIndex node, NodeIndex next, LLVMBasicBlockRef next_block, LLVMBasicBlockRef merge_block)
+{
+    if (cg->block_count == cg->block_capacity)
+    {
+        cg->block_capacity = cg->block_capacity == 0 ? CODEGEN_STACK_INITIAL_CAPACITY : cg->block_capacity * 2;
+        cg->blocks = realloc(cg->blocks, cg->block_capacity * sizeof(GenBlock));
+    }
+    GenBlock* block = &cg->blocks[cg->block_count++];
+    block->node = node;
+    block->next = next;
+    block->in_else = false;
+    block->next_block = next_block;
+    block->merge_block = merge_block;
+}
+
+/*
+ * Emit an expression, operands first and in order, then the node using them
+ */
+LLVMValueRef codegen_expression(codegen_T* cg, NodeIndex exp)
+{
+    unsigned int base = cg->task_count;
+
+    push_gen_task(cg, exp);
+    while (cg->task_count > base)
+    {
+        GenTask* task = &cg->tasks[cg->task_count - 1];
+        if (task->next_operand != NO_NODE)
+        {
+            NodeIndex operand = task->next_operand;
+            task->next_operand = next_operand(cg, task->node, operand);
+            push_gen_task(cg, operand);
+            continue;
+        }
+
+        // Every operand is on the value stack
+        GenTask done = *task;
+        cg->task_count--;
+        LLVMValueRef value = codegen_node(cg, done.node, &cg->values[done.base], cg->value_count - done.base);
+        cg->value_count = done.base;
+        push_gen_value(cg, value);
+    }
+    return cg->values[--cg->value_count];
+}
+
+/*
+ * Operand of node after operand, the first one is always its lhs
+ */
+NodeIndex next_operand(codegen_T* cg, NodeIndex node, NodeIndex operand)
+{
+    Node* parent = &cg->ast->nodes[node];
+    switch (parent->kind)
+    {
+        case NODE_BINARY:
+        case NODE_ARRAY_OP:
+            return operand == parent->lhs ? parent->rhs : NO_NODE;
+        case NODE_CALL:
+            return cg->ast->nodes[operand].next;
+        default:
+            return NO_NODE;
+    }
+}
+
+void push_gen_task(codegen_T* cg, NodeIndex node)
+{
+    if (cg->task_count == cg->task_capacity)
+    {
+        cg->task_capacity = cg->task_capacity == 0 ? CODEGEN_STACK_INITIAL_CAPACITY : cg->task_capacity * 2;
+        cg->tasks = realloc(cg->tasks, cg->task_capacity * sizeof(GenTask));
+    }
+    GenTask* task = &cg->tasks[cg->task_count++];
+    task->node = node;
+    task->next_operand = cg->ast->nodes[node].lhs;
+    task->base = cg->value_count;
+}
+
+void push_gen_value(codegen_T* cg, LLVMValueRef value)
+{
+    if (cg->value_count == cg->value_capacity)
+    {
+        cg->value_capacity = cg->value_capacity == 0 ? CODEGEN_STACK_INITIAL_CAPACITY : cg->value_capacity * 2;
+        cg->values = realloc(cg->values, cg->value_capacity * sizeof(LLVMValueRef));
+    }
+    cg->values[cg->value_count++] = value;
+}
+
+/*
+ * Call func. Arrays are passed by value, an entire array argument
+ * is its address, so its elements are loaded into the argument.
+ */
+LLVMValueRef codegen_call(codegen_T* cg, LLVMValueRef func, LLVMValueRef* args, unsigned int count)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    LLVMTypeRef func_type = LLVMGlobalGetValueType(func);
+    LLVMTypeRef* param_types = malloc(count * sizeof(LLVMTypeRef));
+    LLVMGetParamTypes(func_type, param_types);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (LLVMGetTypeKind(param_types[i]) == LLVMArrayTypeKind && LLVMGetTypeKind(LLVMTypeOf(args[i])) == LLVMPointerTypeKind)
+        {
+            args[i] = LLVMBuildLoad2(compiler->builder, param_types[i], args[i], "");
+        }
+    }
+
+    free(param_types);
+    return LLVMBuildCall2(compiler->builder, func_type, func, args, count, "");
+}
+
+/*
+ * Emit one expression node given the values of its operands
+ */
+LLVMValueRef codegen_node(codegen_T* cg, NodeIndex index, LLVMValueRef* operands, unsigned int count)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    Node* node = &cg->ast->nodes[index];
+    switch (node->kind)
+    {
+        case NODE_INT:
+            return LLVMConstInt(compiler->int32_type, node->data.int_val, true);
+        case NODE_FLOAT:
+            return LLVMConstReal(compiler->float_type, node->data.float_val);
+        case NODE_STRING:
+            return LLVMBuildGlobalStringPtr(compiler->builder, node->data.string_val, "");
+        case NODE_BOOL:
+            return LLVMConstInt(compiler->int1_type, node->data.bool_val ? 1 : 0, 1);
+        case NODE_NAME:
+            return codegen_name(cg, node, count > 0 ? operands[0] : NULL, true);
+        case NODE_DESTINATION:
+            return codegen_name(cg, node, count > 0 ? operands[0] : NULL, false);
+        case NODE_CALL:
+            return codegen_call(cg, node->data.symbol->llvm_function, operands, count);
+        case NODE_ARGUMENT:
+            return codegen_conversion(cg, operands[0], node->lhs_conv);
+        case NODE_NEGATE:
+            if (node->operand_type == TC_FLOAT)
+            {
+                return LLVMBuildFNeg(compiler->builder, operands[0], "");
+            }
+            return LLVMBuildNeg(compiler->builder, operands[0], "");
+        case NODE_NOT:
+            return LLVMBuildNot(compiler->builder, operands[0], "");
+        case NODE_BINARY:
+            return codegen_operator(cg, node, operands[0], operands[1]);
+        case NODE_ARRAY_OP:
+            return codegen_array_op(cg, node, operands[0], operands[1]);
+        default:
+            return NULL;
+    }
+}
+
+/*
+ * Value of a name, or the address it stores to when load is false.
+ * An index is checked against the array bound first.
+ */
+LLVMValueRef codegen_name(codegen_T* cg, Node* node, LLVMValueRef index, bool load)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    Symbol* id = node->data.symbol;
+    LLVMValueRef address = id->llvm_address;
+    LLVMValueRef zero_val = LLVMConstInt(compiler->int32_type, 0, true);
+
+    if (index != NULL)
+    {
+        // Code gen: check 0 <= exp value < arr bound
+        LLVMValueRef bound_val = LLVMConstInt(compiler->int32_type, id->arr_size, true);
+        LLVMValueRef lt_bound = LLVMBuildICmp(compiler->builder, LLVMIntSLT, index, bound_val, "");
+        LLVMValueRef gte_zero = LLVMBuildICmp(compiler->builder, LLVMIntSGE, index, zero_val, "");
+        LLVMValueRef cond = LLVMBuildAnd(compiler->builder, lt_bound, gte_zero, "");
+
+        LLVMBasicBlockRef bound_err_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "boundErr");
+        LLVMBasicBlockRef no_err_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "noErr");
+
+        // If invalid index, display error and exit
+        LLVMBuildCondBr(compiler->builder, cond, no_err_block, bound_err_block);
+        LLVMPositionBuilderAtEnd(compiler->builder, bound_err_block);
+        LLVMValueRef err_func = LLVMGetNamedFunction(compiler->module, "outOfBoundsError");
+        LLVMBuildCall(compiler->builder, err_func, NULL, 0, "");
+        // Need a terminator to satisfy LLVM, but it will exit(1) before reaching
+        LLVMBuildBr(compiler->builder, no_err_block);
+        LLVMPositionBuilderAtEnd(compiler->builder, no_err_block);
+
+        // Get pointer to the element of the array
+        LLVMValueRef indices[] = { zero_val, index };
+        address = LLVMBuildInBoundsGEP(compiler->builder, address, indices, 2, "");
+    }
+    else if (id->is_arr)
+    {
+        // Either passing whole array as arg, or doing fancy array assignment
+        return address;
+    }
+
+    if (!load)
+    {
+        return address;
+    }
+    return LLVMBuildLoad2(compiler->builder, create_llvm_type(compiler, id->type), address, "");
+}
+
+LLVMValueRef codegen_conversion(codegen_T* cg, LLVMValueRef value, Conversion conv)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    switch (conv)
+    {
+        case CONV_INT_TO_FLOAT:
+            return LLVMBuildSIToFP(compiler->builder, value, compiler->float_type, "");
+        case CONV_INT_TO_BOOL:
+            return LLVMBuildICmp(compiler->builder, LLVMIntNE, value, LLVMConstInt(compiler->int32_type, 0, true), "");
+        // The builder folds constants like the LLVMConst* functions did,
+        // and also converts values only known at run time
+        case CONV_CONST_BOOL_TO_INT:
+            return LLVMBuildZExt(compiler->builder, value, compiler->int32_type, "");
+        case CONV_CONST_FLOAT_TO_INT:
+            return LLVMBuildFPToSI(compiler->builder, value, compiler->int32_type, "");
+        case CONV_CONST_INT_TO_FLOAT:
+            return LLVMBuildSIToFP(compiler->builder, value, compiler->float_type, "");
+        case CONV_CONST_INT_TO_BOOL:
+            return LLVMBuildICmp(compiler->builder, LLVMIntNE, value, LLVMConstInt(compiler->int32_type, 0, true), "");
+        default:
+            return value;
+    }
+}
+
+/*
+ * Apply the binary operator of node to its converted operands
+ */
+LLVMValueRef codegen_operator(codegen_T* cg, Node* node, LLVMValueRef lhs, LLVMValueRef rhs)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    lhs = codegen_conversion(cg, lhs, node->lhs_conv);
+    rhs = codegen_conversion(cg, rhs, node->rhs_conv);
+
+    bool is_float = node->operand_type == TC_FLOAT;
+    bool is_bool = node->operand_type == TC_BOOL;
+    switch (node->op)
+    {
+        case T_PLUS:
+            return is_float ? LLVMBuildFAdd(compiler->builder, lhs, rhs, "") : LLVMBuildAdd(compiler->builder, lhs, rhs, "");
+        case T_MINUS:
+            return is_float ? LLVMBuildFSub(compiler->builder, lhs, rhs, "") : LLVMBuildSub(compiler->builder, lhs, rhs, "");
+        case T_MULTIPLY:
+            return is_float ? LLVMBuildFMul(compiler->builder, lhs, rhs, "") : LLVMBuildMul(compiler->builder, lhs, rhs, "");
+        case T_DIVIDE:
+            return is_float ? LLVMBuildFDiv(compiler->builder, lhs, rhs, "") : LLVMBuildSDiv(compiler->builder, lhs, rhs, "");
+        case T_LT:
+            if (is_float)
+            {
+                return LLVMBuildFCmp(compiler->builder, LLVMRealOLT, lhs, rhs, "");
+            }
+            return LLVMBuildICmp(compiler->builder, is_bool ? LLVMIntULT : LLVMIntSLT, lhs, rhs, "");
+        case T_LTEQ:
+            if (is_float)
+            {
+                return LLVMBuildFCmp(compiler->builder, LLVMRealOLE, lhs, rhs, "");
+            }
+            return LLVMBuildICmp(compiler->builder, is_bool ? LLVMIntULE : LLVMIntSLE, lhs, rhs, "");
+        case T_GT:
+            if (is_float)
+            {
+                return LLVMBuildFCmp(compiler->builder, LLVMRealOGT, lhs, rhs, "");
+            }
+            return LLVMBuildICmp(compiler->builder, is_bool ? LLVMIntUGT : LLVMIntSGT, lhs, rhs, "");
+        case T_GTEQ:
+            if (is_float)
+            {
+                return LLVMBuildFCmp(compiler->builder, LLVMRealOGE, lhs, rhs, "");
+            }
+            return LLVMBuildICmp(compiler->builder, is_bool ? LLVMIntUGE : LLVMIntSGE, lhs, rhs, "");
+        case T_EQ:
+            if (is_float)
+            {
+                return LLVMBuildFCmp(compiler->builder, LLVMRealOEQ, lhs, rhs, "");
+            }
+            else if (node->operand_type == TC_STRING)
+            {
+                return string_comparison(cg, lhs, rhs);
+            }
+            return LLVMBuildICmp(compiler->builder, LLVMIntEQ, lhs, rhs, "");
+        case T_NOT_EQ:
+            if (is_float)
+            {
+                return LLVMBuildFCmp(compiler->builder, LLVMRealONE, lhs, rhs, "");
+            }
+            else if (node->operand_type == TC_STRING)
+            {
+                return LLVMBuildNot(compiler->builder, string_comparison(cg, lhs, rhs), "");
+            }
+            return LLVMBuildICmp(compiler->builder, LLVMIntNE, lhs, rhs, "");
+        case T_AND:
+            return LLVMBuildAnd(compiler->builder, lhs, rhs, "");
+        case T_OR:
+            return LLVMBuildOr(compiler->builder, lhs, rhs, "");
+        default:
+            return NULL;
+    }
+}
+
+/*
+ * Ops done on unindexed arrays affect the whole array.
+ * Returns the address of a new array holding the result.
+ */
+LLVMValueRef codegen_array_op(codegen_T* cg, Node* node, LLVMValueRef lhs, LLVMValueRef rhs)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    Node* lhs_node = &cg->ast->nodes[node->lhs];
+    Node* rhs_node = &cg->ast->nodes[node->rhs];
+    LLVMTypeRef ty = LLVMArrayType(create_llvm_type(compiler, node->type), node->arr_size);
+
+    // Allocate a new array to store the result
+    LLVMValueRef result_arr_address = LLVMBuildAlloca(compiler->builder, ty, "");
+
+    LLVMBasicBlockRef arr_op_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "arrOp");
+    LLVMBasicBlockRef arr_op_merge_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "arrOpMerge");
+
+    // Intial index = 0
+    LLVMValueRef ind_addr = LLVMBuildAlloca(compiler->builder, create_llvm_type(compiler, TC_INT), "arrOpInd");
+    LLVMValueRef zero_val = LLVMConstInt(compiler->int32_type, 0, true);
+    LLVMValueRef index = zero_val;
+    LLVMBuildStore(compiler->builder, index, ind_addr);
+
+    // Max value of index is arr_size - 1
+    LLVMValueRef loop_end = LLVMConstInt(compiler->int32_type, node->arr_size, true);
+
+    LLVMBuildBr(compiler->builder, arr_op_block);
+    LLVMPositionBuilderAtEnd(compiler->builder, arr_op_block);
+
+    index = LLVMBuildLoad2(compiler->builder, create_llvm_type(compiler, TC_INT), ind_addr, "");
+
+    // If the operand is an unindexed array, load the element of the current index
+    LLVMValueRef indices[] = { zero_val, index };
+    LLVMValueRef lhs_elem = lhs;
+    if (lhs_node->is_arr)
+    {
+        // Get pointer to array element, and load the value
+        LLVMValueRef elem_addr = LLVMBuildInBoundsGEP(compiler->builder, lhs, indices, 2, "");
+        lhs_elem = LLVMBuildLoad2(compiler->builder, create_llvm_type(compiler, lhs_node->type), elem_addr, "");
+    }
+
+    LLVMValueRef rhs_elem = rhs;
+    if (rhs_node->is_arr)
+    {
+        // Get pointer to array element, and load the value
+        LLVMValueRef elem_addr = LLVMBuildInBoundsGEP(compiler->builder, rhs, indices, 2, "");
+        rhs_elem = LLVMBuildLoad2(compiler->builder, create_llvm_type(compiler, rhs_node->type), elem_addr, "");
+    }
+
+    LLVMValueRef result = codegen_operator(cg, &cg->ast->nodes[node->extra], lhs_elem, rhs_elem);
+
+    // Get pointer to result array element, and store the result of the calculation
+    LLVMValueRef elem_addr = LLVMBuildInBoundsGEP(compiler->builder, result_arr_address, indices, 2, "");
+    LLVMBuildStore(compiler->builder, result, elem_addr);
+
+    // Increment index
+    LLVMValueRef increment = LLVMConstInt(compiler->int32_type, 1, true);
+    index = LLVMBuildAdd(compiler->builder, index, increment, "");
+    LLVMBuildStore(compiler->builder, index, ind_addr);
+
+    // if index < array size
+    LLVMValueRef cond = LLVMBuildICmp(compiler->builder, LLVMIntSLT, index, loop_end, "");
+    LLVMBuildCondBr(compiler->builder, cond, arr_op_block, arr_op_merge_block);
+
+    LLVMPositionBuilderAtEnd(compiler->builder, arr_op_merge_block);
+    return result_arr_address;
+}
+
+/*
+ * Compare strings character by character. Return LLVM value for whether they are equal.
+ */
+LLVMValueRef string_comparison(codegen_T* cg, LLVMValueRef lhs, LLVMValueRef rhs)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    LLVMBasicBlockRef str_cmp_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "strCmp");
+    LLVMBasicBlockRef str_cmp_merge_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "strCmpMerge");
+
+    // Initial index = 0
+    LLVMValueRef ind_addr = LLVMBuildAlloca(compiler->builder, create_llvm_type(compiler, TC_INT), "strCmpInd");
+    LLVMValueRef index = LLVMConstInt(compiler->int32_type, 0, true);
+    LLVMBuildStore(compiler->builder, index, ind_addr);
+
+    LLVMBuildBr(compiler->builder, str_cmp_block);
+    LLVMPositionBuilderAtEnd(compiler->builder, str_cmp_block);
+
+    index = LLVMBuildLoad2(compiler->builder, create_llvm_type(compiler, TC_INT), ind_addr, "");
+
+    // Get element pointer to string character, then load the character
+    LLVMValueRef lhs_char_address = LLVMBuildInBoundsGEP(compiler->builder, lhs, &index, 1, "");
+    LLVMValueRef rhs_char_address = LLVMBuildInBoundsGEP(compiler->builder, rhs, &index, 1, "");
+    LLVMValueRef lhs_char_value = LLVMBuildLoad2(compiler->builder, compiler->int8_type, lhs_char_address, "");
+    LLVMValueRef rhs_char_value = LLVMBuildLoad2(compiler->builder, compiler->int8_type, rhs_char_address, "");
+
+    // Compare lhs == rhs
+    LLVMValueRef cmp = LLVMBuildICmp(compiler->builder, LLVMIntEQ, lhs_char_value, rhs_char_value, "");
+
+    // Null terminator char \0
+    LLVMValueRef zero_val_8 = LLVMConstInt(compiler->int8_type, 0, true);
+
+    // See if one char is null terminator.
+    // Ignore the rhs char since if they're unequal it doesn't matter anyway
+    LLVMValueRef not_null_term = LLVMBuildICmp(compiler->builder, LLVMIntNE, lhs_char_value, zero_val_8, "");
+
+    // Increment index
+    LLVMValueRef increment = LLVMConstInt(compiler->int32_type, 1, true);
+    index = LLVMBuildAdd(compiler->builder, index, increment, "");
+    LLVMBuildStore(compiler->builder, index, ind_addr);
+
+    // Keep checking if not the end And lhs == rhs so far
+    LLVMValueRef and_cond = LLVMBuildAdd(compiler->builder, cmp, not_null_term, "");
+    LLVMBuildCondBr(compiler->builder, and_cond, str_cmp_block, str_cmp_merge_block);
+    LLVMPositionBuilderAtEnd(compiler->builder, str_cmp_merge_block);
+    return cmp;
+}
+
+// Codegen to copy the elements from one array to another
+void array_assignment_codegen(codegen_T* cg, LLVMValueRef dest, LLVMValueRef exp, TypeClass type, int arr_size)
+{
+    bp_compiler_T* compiler = cg->compiler;
+    LLVMBasicBlockRef arr_copy_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "arrCopy");
+    LLVMBasicBlockRef arr_copy_merge_block = LLVMAppendBasicBlockInContext(compiler->context, cg->func, "arrCopyMerge");
+
+    // Initial index = 0
+    LLVMValueRef ind_addr = LLVMBuildAlloca(compiler->builder, create_llvm_type(compiler, TC_INT), "arrCopyInd");
+    LLVMValueRef zero_val = LLVMConstInt(compiler->int32_type, 0, true);
+    LLVMValueRef index = zero_val;
+    LLVMBuildStore(compiler->builder, index, ind_addr);
+
+    // Max value of index is arr_size - 1
+    LLVMValueRef loop_end = LLVMConstInt(compiler->int32_type, arr_size, true);
+    LLVMBuildBr(compiler->builder, arr_copy_block);
+    LLVMPositionBuilderAtEnd(compiler->builder, arr_copy_block);
+
+    index = LLVMBuildLoad2(compiler->builder, create_llvm_type(compiler, TC_INT), ind_addr, "");
+
+    LLVMValueRef indices[] = { zero_val, index };
+    // Get pointer to array element, and load the value
+    LLVMValueRef exp_elem_addr = LLVMBuildInBoundsGEP(compiler->builder, exp, indices, 2, "");
+    LLVMValueRef exp_elem_val = LLVMBuildLoad2(compiler->builder, create_llvm_type(compiler, type), exp_elem_addr, "");
+
+    // Get pointer to dest array element, and store the value
+    LLVMValueRef dest_elem_addr = LLVMBuildInBoundsGEP(compiler->builder, dest, indices, 2, "");
+    LLVMBuildStore(compiler->builder, exp_elem_val, dest_elem_addr);
+
+    // Increment index
+    LLVMValueRef increment = LLVMConstInt(compiler->int32_type, 1, true);
+    index = LLVMBuildAdd(compiler->builder, index, increment, "");
+    LLVMBuildStore(compiler->builder, index, ind_addr);
+
+    // index < arr size
+    LLVMValueRef cond = LLVMBuildICmp(compiler->builder, LLVMIntSLT, index, loop_end, "");
+    LLVMBuildCondBr(compiler->builder, cond, arr_copy_block, arr_copy_merge_block);
+    LLVMPositionBuilderAtEnd(compiler->builder, arr_copy_merge_block);
+}
@@ -0,0 +1,61 @@
+#include "include/compiler.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <llvm-c/Target.h>
+
+
+/*
+ * Compiler context constructor, the LLVM state is created by codegen_context
+ */
+bp_compiler_T* init_compiler(const char* file_name, const char* output_name)
+{
+    bp_compiler_T* compiler = calloc(1, sizeof(struct BP_COMPILER_STRUCT));
+    compiler->file_name = file_name;
+    compiler->output_name = output_name;
+    compiler->symbol_arena = init_arena();
+    return compiler;
+}
+
+/*
+ * Release the symbols and identifiers, every handle into them becomes invalid
+ */
+void free_compiler(bp_compiler_T* compiler)
+{
+    if (compiler != NULL)
+    {
+        free_intern_pool(&compiler->pool);
+        free_arena(compiler->symbol_arena);
+        free(compiler->diagnostics);
+        free(compiler);
+    }
+}
+
+/*
+ * Hand the collected diagnostics to the caller, who frees them.
+ * Never NULL, the text is empty when nothing was reported.
+ */
+char* take_diagnostics(bp_compiler_T* compiler)
+{
+    char* diagnostics = compiler->diagnostics != NULL ? compiler->diagnostics : calloc(1, 1);
+    compiler->diagnostics = NULL;
+    compiler->diagnostics_length = 0;
+    compiler->diagnostics_capacity = 0;
+    return diagnostics;
+}
+
+/*
+ * Targets are registered process-wide, once for every compilation
+ */
+static pthread_once_t llvm_initialized = PTHREAD_ONCE_INIT;
+
+static void register_targets()
+{
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+    LLVMInitializeNativeAsmParser();
+}
+
+void initialize_llvm()
+{
+    pthread_once(&llvm_initialized, register_targets);
+}
@@ -1,23 +1,92 @@
 #include "error.h"
+#include <string.h>
 
-const char* file_name;
+void throw_error(bp_compiler_T* compiler, char* msg, Token* tok)
+{
+    compiler->error_flag = true;
+    compiler->error_count++;
+    report_diagnostic(compiler, "%s:\n", compiler->file_name);
+    report_diagnostic(compiler, "ERROR: %s\n", msg);
+}
 
-void set_file_name(const char* name)
+/*
+ * Print a diagnostic, or append it to the collected ones
+ */
+void report_diagnostic(bp_compiler_T* compiler, const char* fmt, ...)
 {
-    file_name = name;
+    compiler->diagnostic_count++;
+    va_list args;
+    va_start(args, fmt);
+    if (!compiler->collect_diagnostics)
+    {
+        vprintf(fmt, args);
+        va_end(args);
+        return;
+    }
+
+    char* text = NULL;
+    int length = vasprintf(&text, fmt, args);
+    va_end(args);
+    if (length < 0)
+    {
+        return;
+    }
+
+    size_t needed = compiler->diagnostics_length + length + 1;
+    if (needed > compiler->diagnostics_capacity)
+    {
+        compiler->diagnostics_capacity = needed * 2;
+        compiler->diagnostics = realloc(compiler->diagnostics, compiler->diagnostics_capacity);
+    }
+    memcpy(compiler->diagnostics + compiler->diagnostics_length, text, length + 1);
+    compiler->diagnostics_length += length;
+    free(text);
 }
 
-void throw_error(char* msg, Token* tok)
+/*
+ * Backend of the debug_parser macro, only reached when parser debugging is on
+ */
+void debug_parser_printf(const char* fmt, ...)
 {
-    error_flag = true;
-    printf("%s:\n", file_name);
-    printf("ERROR: %s\n", msg);
+    va_list args;
+    va_start(args, fmt);
+    printf("Debugging parser: ");
+    vprintf(fmt, args);
+    printf("\n");
+    va_end(args);
 }
 
-void debug_parser_statement(char* msg, bool flag)
+/*
+ * Record an event in the ring buffer of the most recent parser events
+ */
+void trace_parser_event(bp_compiler_T* compiler, const char* event, TokenType expected, Token* look_ahead)
 {
-    if (flag)
+    TraceEvent* slot = &compiler->trace_ring[compiler->trace_count % TRACE_RING_SIZE];
+    slot->event = event;
+    slot->expected = expected;
+    slot->look_ahead = *look_ahead;
+    compiler->trace_count++;
+}
+
+/*
+ * Print the recorded events from oldest to newest
+ */
+void dump_parser_trace(bp_compiler_T* compiler)
+{
+    unsigned int trace_count = compiler->trace_count;
+    unsigned int first = trace_count > TRACE_RING_SIZE ? trace_count - TRACE_RING_SIZE : 0;
+    Token expected;
+
+    printf("Last %u parser events:\n", trace_count - first);
+    for (unsigned int i = first; i < trace_count; i++)
     {
-        printf("Debugging parser: %s\n", msg);
+        TraceEvent* slot = &compiler->trace_ring[i % TRACE_RING_SIZE];
+        init_token(&expected, slot->expected);
+        char* expected_text = print_token(&expected);
+        char* look_ahead = print_token(&slot->look_ahead);
+        printf("  %s, expected %s", slot->event, expected_text);
+        printf("      look ahead %s", look_ahead[0] != '\0' ? look_ahead : "T_UNKNOWN\n");
+        free(expected_text);
+        free(look_ahead);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,42 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+/*
+ * Bump allocator over a list of chunks.
+ * Chunks are kept when the arena is reset or rewound and reused by later
+ * allocations, so a reset does not touch malloc at all.
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk* next;
+    size_t size;
+    size_t used;
+    _Alignas(ARENA_ALIGN) char data[];  // Aligned like every size arena_alloc hands out
+} ArenaChunk;
+
+typedef struct ARENA_STRUCT {
+    ArenaChunk* head;
+    ArenaChunk* current;
+} arena_T;
+
+/*
+ * Position in an arena, everything allocated after it
+ * is released by arena_release
+ */
+typedef struct ArenaMark {
+    ArenaChunk* chunk;
+    size_t used;
+} ArenaMark;
+
+arena_T* init_arena();
+void* arena_alloc(arena_T* arena, size_t size);
+ArenaMark arena_mark(arena_T* arena);
+void arena_release(arena_T* arena, ArenaMark mark);
+void arena_reset(arena_T* arena);
+void free_arena(arena_T* arena);
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef AST_H
+#define AST_H
+
+#include <stdbool.h>
+
+#include "symbol.h"
+#include "arena.h"
+
+#define AST_INITIAL_CAPACITY 256
+
+// Index 0 is never a node, it marks a missing child
+#define NO_NODE 0
+
+typedef unsigned int NodeIndex;
+
+/*
+ * Kinds of nodes. Children are node indexes:
+ *
+ * NODE_INT, NODE_FLOAT, NODE_STRING, NODE_BOOL   literal in data
+ * NODE_NAME          load of data.symbol, lhs is the optional index
+ * NODE_DESTINATION   address of data.symbol, lhs is the optional index
+ * NODE_CALL          call of data.symbol, lhs is the first NODE_ARGUMENT
+ * NODE_ARGUMENT      lhs converted by lhs_conv, next is the next argument
+ * NODE_NEGATE        - lhs
+ * NODE_NOT           not lhs
+ * NODE_BINARY        lhs op rhs, operands converted by lhs_conv and rhs_conv
+ * NODE_ARRAY_OP      lhs op rhs on each element, extra is the NODE_BINARY
+ *                    applied to the elements, it has no children itself
+ * NODE_ASSIGN        lhs is the NODE_DESTINATION, rhs converted by rhs_conv
+ * NODE_IF            lhs is the condition, rhs the then list, extra the else list
+ * NODE_LOOP          lhs is the NODE_ASSIGN, rhs the condition, extra the body
+ * NODE_RETURN        lhs converted by lhs_conv
+ *
+ * Statements of a list are chained through next.
+ */
+typedef enum NodeKind {
+    NODE_INT,
+    NODE_FLOAT,
+    NODE_STRING,
+    NODE_BOOL,
+    NODE_NAME,
+    NODE_DESTINATION,
+    NODE_CALL,
+    NODE_ARGUMENT,
+    NODE_NEGATE,
+    NODE_NOT,
+    NODE_BINARY,
+    NODE_ARRAY_OP,
+    NODE_ASSIGN,
+    NODE_IF,
+    NODE_LOOP,
+    NODE_RETURN
+} NodeKind;
+
+/*
+ * Conversion of an operand decided by type checking.
+ * The constant ones are folded, they only apply to constants.
+ */
+typedef enum Conversion {
+    CONV_NONE,
+    CONV_INT_TO_FLOAT,
+    CONV_INT_TO_BOOL,           // All non-zero values are true
+    CONV_CONST_BOOL_TO_INT,
+    CONV_CONST_FLOAT_TO_INT,
+    CONV_CONST_INT_TO_FLOAT,
+    CONV_CONST_INT_TO_BOOL
+} Conversion;
+
+/*
+ * A node of the pool. Enums are stored in bytes to keep it small.
+ */
+typedef struct Node {
+    unsigned char kind;             // NodeKind
+    unsigned char op;               // TokenType of a binary operator
+    unsigned char type;             // TypeClass of the result
+    unsigned char operand_type;     // TypeClass the operator works on, after conversions
+    unsigned char lhs_conv;         // Conversion
+    unsigned char rhs_conv;         // Conversion
+    bool is_arr;                    // Result is a whole, unindexed array
+    int arr_size;
+    NodeIndex lhs;
+    NodeIndex rhs;
+    NodeIndex extra;
+    NodeIndex next;
+    union {
+        int int_val;
+        float float_val;
+        bool bool_val;
+        const char* string_val;     // In the string arena of the tree
+        Symbol* symbol;             // Entry of the scope stack
+    } data;
+} Node;
+
+/*
+ * Syntax tree of the bodies being compiled, all nodes in one pool.
+ * Nodes refer to each other by index, so the pool can grow in place.
+ */
+typedef struct AST_STRUCT {
+    Node* nodes;
+    unsigned int count;
+    unsigned int capacity;
+    arena_T* strings;
+} ast_T;
+
+/*
+ * Position in the tree, everything added after it is released by ast_release
+ */
+typedef struct AstMark {
+    unsigned int count;
+    ArenaMark strings;
+} AstMark;
+
+/*
+ * Result of an expression, passed by value through the expression parser.
+ * Holds the type of the expression and the node computing it.
+ */
+typedef struct Value {
+    TypeClass type;
+    int arr_size;
+    bool is_arr;
+    bool is_indexed;
+    NodeIndex node;
+} Value;
+
+ast_T* init_ast();
+void free_ast(ast_T* ast);
+NodeIndex ast_add(ast_T* ast, NodeKind kind);
+const char* ast_copy_string(ast_T* ast, const char* str);
+AstMark ast_mark(ast_T* ast);
+void ast_release(ast_T* ast, AstMark mark);
+
+Value init_value();
+Value init_value_from_symbol(Symbol* sym);
+
+#endif
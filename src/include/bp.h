@@ -2,8 +2,88 @@
 #define BP_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
-void bp_compile(char* src, const char* name, bool parser_flag, bool table_flag, bool jit_flag);
-void bp_compile_file(const char* filename, bool parser_flag, bool table_flag, bool jit_flag);
+/*
+ * What bp_compile writes to its output
+ */
+typedef enum
+{
+    BP_OUTPUT_BITCODE,
+    BP_OUTPUT_OBJECT,               // Native object for the target machine
+    BP_OUTPUT_EXECUTABLE            // The object linked by the system C compiler
+} bp_output_T;
 
-#endif
\ No newline at end of file
+/*
+ * Compile src to output. Returns false if it could not be written,
+ * nothing is left behind in the temporary directory then.
+ */
+bool bp_compile(const char* src, size_t length, const char* name, const char* output, bool parser_flag, bool table_flag, bool jit_flag, bool trace_flag, int jobs, const char* opt_level, bp_output_T output_kind, const char* cpu);
+bool bp_compile_file(const char* filename, bool parser_flag, bool table_flag, bool jit_flag, bool trace_flag, int jobs, const char* opt_level);
+
+/*
+ * Compile every input to a .bc file next to it on a pool of jobs worker
+ * processes, all online CPUs if jobs < 1, with the opt_level and cpu of
+ * bp_compile. A file that crashes the compiler fails on its own.
+ * "@list" inputs name manifests with one file per line. Prints a status
+ * line per file and returns the number that failed.
+ */
+int bp_compile_batch(char** inputs, int count, int jobs, const char* opt_level, const char* cpu);
+
+/*
+ * Compile src and run it in this process. Each procedure is compiled, and
+ * optimized for opt_level, the first time it is called. The code is for
+ * cpu, the host's if it is NULL. Returns 1 if the program has errors, else 0.
+ */
+int bp_run(const char* src, size_t length, const char* name, const char* opt_level, const char* cpu);
+
+/*
+ * A program compiled in memory and JIT'd into the process.
+ * Handles are independent, several can be loaded and used from
+ * different threads at once.
+ */
+typedef struct BP_PROGRAM_STRUCT bp_program_T;
+
+typedef void (*bp_main_T)(void);
+
+/*
+ * Compile src without touching the disk or exiting.
+ * Returns NULL if it has errors, the diagnostics are then in *diagnostics.
+ * If diagnostics is not NULL, *diagnostics is always set and freed with free().
+ */
+bp_program_T* bp_load_program(const char* src, size_t length, const char* name, char** diagnostics);
+
+/*
+ * Compile src to bitcode in memory without touching the disk or exiting.
+ * On success *bitcode holds the module, otherwise it is NULL. *bitcode and
+ * *diagnostics are always set and freed with free().
+ */
+bool bp_compile_to_memory(const char* src, size_t length, const char* name, char** bitcode, size_t* bitcode_length, char** diagnostics);
+
+/*
+ * bp_compile_to_memory, or with the error policy of bp_compile if not
+ * strict: programs with errors the parser recovered from still compile,
+ * and the diagnostics of one that does not parse read like bp_compile's.
+ * opt_level and cpu are those of bp_compile.
+ */
+bool bp_compile_bitcode(const char* src, size_t length, const char* name, bool strict, const char* opt_level, const char* cpu, char** bitcode, size_t* bitcode_length, char** diagnostics);
+
+/*
+ * Entry point of the program body
+ */
+bp_main_T bp_program_main(bp_program_T* program);
+
+/*
+ * Address of a procedure, NULL if there is none by that name.
+ * Names are case insensitive like in the language. Integers are int32_t,
+ * floats float, bools bool and strings char*. Arrays are passed by value,
+ * so only procedures with scalar parameters are callable from C.
+ */
+void* bp_program_procedure(bp_program_T* program, const char* name);
+
+/*
+ * Release the code of the program, its pointers become invalid
+ */
+void bp_free_program(bp_program_T* program);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BP_CACHE_KEY_SIZE 33                    // 128 bit hash in hex and '\0'
+#define BP_CACHE_DEFAULT_LIMIT (256ull << 20)
+
+/*
+ * Counters of the cache, kept in the stats file of its directory
+ */
+typedef struct CacheStats
+{
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long files;
+    unsigned long long size;
+} CacheStats;
+
+bool cache_enabled();
+char* cache_options(int jobs, const char* opt_level, const char* cpu);
+void cache_key(const char* src, size_t length, const char* options, char* key);
+char* cache_load(const char* key, size_t* length);
+void cache_save(const char* key, const char* data, size_t length);
+bool cache_fetch(const char* key, const char* output);
+void cache_store(const char* key, const char* file);
+bool compile_cached(const char* src, size_t length, const char* name, bool strict, const char* opt_level, const char* cpu, char** bitcode, size_t* bitcode_length, char** diagnostics);
+void print_cache_stats();
+
+#endif
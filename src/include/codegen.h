@@ -0,0 +1,149 @@
+#ifndef CODEGEN_H
+#define CODEGEN_H
+#include "ast.h"
+#include "semantic.h"
+#include "compiler.h"
+
+#include <llvm-c/Core.h>
+#include <llvm-c/Analysis.h>
+#include <llvm-c/IRReader.h>
+#include <llvm-c/BitReader.h>
+#include <llvm-c/BitWriter.h>
+#include <llvm-c/Linker.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+
+
+#define CODEGEN_STACK_INITIAL_CAPACITY 16
+#define CODEGEN_UNITS_INITIAL_CAPACITY 16
+
+/*
+ * If or loop statement whose statement list is being emitted,
+ * node is NO_NODE for the list codegen_statements was called with
+ */
+typedef struct GenBlock {
+    NodeIndex node;
+    NodeIndex next;                 // Next statement of the list
+    bool in_else;
+    LLVMBasicBlockRef next_block;   // Else block of an if, header of a loop
+    LLVMBasicBlockRef merge_block;
+} GenBlock;
+
+/*
+ * Expression node whose operands are being emitted
+ */
+typedef struct GenTask {
+    NodeIndex node;
+    NodeIndex next_operand;         // NO_NODE once every operand is emitted
+    unsigned int base;              // Values of the operands start here
+} GenTask;
+
+/*
+ * Procedure body ready to be emitted on its own, without the scope stack.
+ * symbols holds copies of every symbol the body refers to, the locals
+ * first, and the nodes of the body point at the copies instead of the scope.
+ * The copies of names declared outside keep the values of the main module,
+ * a worker rebinds them to its own module by name.
+ */
+typedef struct ProcedureUnit {
+    Symbol proc;
+    Symbol* symbols;
+    unsigned int symbol_count;
+    unsigned int local_count;
+    NodeIndex body;
+    bool serial;                    // Refers to a local of an enclosing procedure
+    bool valid;                     // Every path returns, set once emitted
+    ArenaMark mark;                 // Start of the copies in the unit arena
+    LLVMModuleRef module;           // Own module of the procedure, see codegen_split_units
+} ProcedureUnit;
+
+/*
+ * Walks the syntax tree of a body and emits its IR into llvm_module.
+ * Nested statements and expressions are kept on explicit stacks,
+ * so their depth is not limited by the C stack.
+ */
+typedef struct CODEGEN_STRUCT
+{
+    bp_compiler_T* compiler;
+    Semantic* sem;
+    ast_T* ast;
+    LLVMValueRef func;              // Function of the body being emitted
+
+    GenBlock* blocks;
+    unsigned int block_count;
+    unsigned int block_capacity;
+    GenTask* tasks;
+    unsigned int task_count;
+    unsigned int task_capacity;
+    LLVMValueRef* values;
+    unsigned int value_count;
+    unsigned int value_capacity;
+
+    // Procedures captured for emission, only kept past their body with -j
+    ProcedureUnit* units;
+    unsigned int unit_count;
+    unsigned int unit_capacity;
+    arena_T* unit_arena;
+
+    // Slot of each binding in the unit being captured,
+    // valid when its stamp is the capture stamp
+    unsigned int* stamps;
+    unsigned int* slots;
+    unsigned int stamp_capacity;
+    unsigned int capture_stamp;
+} codegen_T;
+
+/*
+ * Code generation thread of -j, emits units of the shared codegen
+ * into its own context and returns them as bitcode
+ */
+typedef struct CodegenWorker {
+    codegen_T* parent;
+    LLVMMemoryBufferRef header;     // Declarations of the main module
+    unsigned int* next_unit;        // Shared, taken atomically
+    LLVMMemoryBufferRef result;     // NULL if the worker could not read the header
+} CodegenWorker;
+
+codegen_T* init_codegen(bp_compiler_T* compiler, Semantic* sem, ast_T* ast);
+void free_codegen(codegen_T* cg);
+
+void codegen_context(bp_compiler_T* compiler, LLVMContextRef context);
+void codegen_dispose_context(bp_compiler_T* compiler);
+void load_runtime();
+void codegen_module(bp_compiler_T* compiler, const char* name);
+LLVMValueRef codegen_main_function(bp_compiler_T* compiler);
+void codegen_procedure_declaration(bp_compiler_T* compiler, Symbol* decl);
+void codegen_global_variable(bp_compiler_T* compiler, Symbol* decl);
+ProcedureUnit* capture_procedure_unit(codegen_T* cg, Symbol* proc, NodeIndex first, NodeIndex body);
+void drop_procedure_unit(codegen_T* cg);
+bool codegen_procedure_unit(codegen_T* cg, ProcedureUnit* unit);
+bool codegen_procedure_units(codegen_T* cg, int jobs);
+void codegen_split_units(codegen_T* cg);
+void* codegen_worker(void* arg);
+LLVMModuleRef codegen_declarations(bp_compiler_T* compiler, LLVMModuleRef module);
+void rebind_procedure_unit(bp_compiler_T* compiler, ProcedureUnit* unit);
+void codegen_program_body(codegen_T* cg, Symbol* proc, NodeIndex body);
+LLVMTargetMachineRef codegen_target_machine(bp_compiler_T* compiler);
+bool codegen_optimize(bp_compiler_T* compiler, LLVMModuleRef module, LLVMTargetMachineRef machine);
+bool codegen_emit_object(bp_compiler_T* compiler, LLVMTargetMachineRef machine, const char* path);
+
+void codegen_statements(codegen_T* cg, NodeIndex list);
+void codegen_statement(codegen_T* cg, NodeIndex stmt);
+void codegen_assignment(codegen_T* cg, NodeIndex stmt);
+void push_gen_block(codegen_T* cg, NodeIndex node, NodeIndex next, LLVMBasicBlockRef next_block, LLVMBasicBlockRef merge_block);
+
+LLVMValueRef codegen_expression(codegen_T* cg, NodeIndex exp);
+NodeIndex next_operand(codegen_T* cg, NodeIndex node, NodeIndex operand);
+void push_gen_task(codegen_T* cg, NodeIndex node);
+void push_gen_value(codegen_T* cg, LLVMValueRef value);
+LLVMValueRef codegen_call(codegen_T* cg, LLVMValueRef func, LLVMValueRef* args, unsigned int count);
+LLVMValueRef codegen_node(codegen_T* cg, NodeIndex index, LLVMValueRef* operands, unsigned int count);
+LLVMValueRef codegen_name(codegen_T* cg, Node* node, LLVMValueRef index, bool load);
+LLVMValueRef rebind_value(bp_compiler_T* compiler, LLVMValueRef value);
+LLVMValueRef codegen_conversion(codegen_T* cg, LLVMValueRef value, Conversion conv);
+LLVMValueRef codegen_operator(codegen_T* cg, Node* node, LLVMValueRef lhs, LLVMValueRef rhs);
+LLVMValueRef codegen_array_op(codegen_T* cg, Node* node, LLVMValueRef lhs, LLVMValueRef rhs);
+LLVMValueRef string_comparison(codegen_T* cg, LLVMValueRef lhs, LLVMValueRef rhs);
+void array_assignment_codegen(codegen_T* cg, LLVMValueRef dest, LLVMValueRef exp, TypeClass type, int arr_size);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdbool.h>
+#include <llvm-c/Core.h>
+
+#include "arena.h"
+#include "bp.h"
+#include "intern.h"
+#include "token.h"
+
+#define TRACE_RING_SIZE 32
+
+// Part of the cache key, bump it when the generated code changes
+#define BP_COMPILER_VERSION "1"
+
+/*
+ * A parser event recorded for -dr.
+ * Tokens are stored raw and only formatted when the trace is dumped.
+ */
+typedef struct TraceEvent {
+    const char* event;
+    TokenType expected;
+    Token look_ahead;
+} TraceEvent;
+
+/*
+ * Everything one compilation owns. The lexer, parser, semantic analyzer
+ * and code generator all refer to it, so compilations on different
+ * threads share nothing.
+ */
+typedef struct BP_COMPILER_STRUCT
+{
+    // LLVM state
+    LLVMContextRef context;
+    LLVMModuleRef module;
+    LLVMBuilderRef builder;
+    LLVMValueRef main_func;
+
+    LLVMTypeRef int32_type;
+    LLVMTypeRef int8_type;
+    LLVMTypeRef int1_type;
+    LLVMTypeRef float_type;
+
+    // Diagnostics, printed unless they are collected
+    const char* file_name;
+    const char* output_name;        // Bitcode written here, or what output_kind asks for
+    bp_output_T output_kind;
+    const char* opt_level;          // "O1" to "O3", "Os" or "Oz", NULL to write the module as emitted
+    const char* cpu;                // Target CPU, "native" for the host's, NULL for a generic one
+    bool error_flag;
+    unsigned int error_count;
+    unsigned int diagnostic_count;  // Everything reported, errors or not
+    bool collect_diagnostics;
+    char* diagnostics;              // Collected text, NUL terminated
+    size_t diagnostics_length;
+    size_t diagnostics_capacity;
+    TraceEvent trace_ring[TRACE_RING_SIZE];
+    unsigned int trace_count;
+
+    // Identifiers and symbols
+    InternPool pool;
+    arena_T* symbol_arena;          // Symbols and parameter lists
+} bp_compiler_T;
+
+bp_compiler_T* init_compiler(const char* file_name, const char* output_name);
+void free_compiler(bp_compiler_T* compiler);
+char* take_diagnostics(bp_compiler_T* compiler);
+void initialize_llvm();
+
+#endif
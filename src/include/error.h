@@ -2,17 +2,32 @@
 #define ERROR_FILE_H
 
 #include "token.h"
+#include "compiler.h"
 
 #define MAX_ERRORS 20
 
-extern bool error_flag;
+/*
+ * Parser debug output.
+ * The format arguments are only evaluated when flag is set,
+ * so a disabled trace costs a single branch.
+ */
+#define debug_parser(flag, ...)                 \
+    do {                                        \
+        if (flag)                               \
+        {                                       \
+            debug_parser_printf(__VA_ARGS__);   \
+        }                                       \
+    } while (0)
 
 // void throw_error(error_code code, int line_number, int column_number);
 // void missing_token(TokenType type, int line_number, int column_number);
 // void assert_parser(char* msg);
 
-void set_file_name(const char* name);
-void throw_error(char* msg, Token* tok);
-void debug_parser_statement(char* msg, bool flag);
+void throw_error(bp_compiler_T* compiler, char* msg, Token* tok);
+void report_diagnostic(bp_compiler_T* compiler, const char* fmt, ...);
+void debug_parser_printf(const char* fmt, ...);
 
-#endif
\ No newline at end of file
+void trace_parser_event(bp_compiler_T* compiler, const char* event, TokenType expected, Token* look_ahead);
+void dump_parser_trace(bp_compiler_T* compiler);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * An interned identifier.
+ * Every distinct string is stored exactly once, so two handles
+ * name the same identifier if and only if the pointers are equal.
+ * The hash is computed once, when the string is first interned.
+ */
+typedef struct InternedString {
+    unsigned int hash;
+    unsigned int length;
+    char str[];
+} InternedString;
+
+/*
+ * Open addressing table of interned strings, capacity is a power of two.
+ * A zeroed pool is empty.
+ */
+typedef struct InternPool {
+    const InternedString** slots;
+    unsigned int capacity;
+    unsigned int count;
+} InternPool;
+
+const InternedString* intern_string(InternPool* pool, const char* str, size_t length, bool fold_case);
+const InternedString* intern_cstr(InternPool* pool, const char* str);
+void free_intern_pool(InternPool* pool);
+
+#endif
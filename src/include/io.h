@@ -1,6 +1,24 @@
 #ifndef BP_IO_H
 #define BP_IO_H
 
-char* bp_read_file(const char* filename);
+#include <stdbool.h>
+#include <stddef.h>
 
-#endif
\ No newline at end of file
+/*
+ * Read-only view of a source file.
+ * The contents are always followed by a '\0' sentinel byte
+ * that is not counted in length.
+ */
+typedef struct SOURCE_STRUCT
+{
+    const char* contents;
+    size_t length;
+    size_t mapped_size;
+    bool is_mapped;
+} source_T;
+
+source_T* bp_open_source(const char* filename);
+source_T* bp_try_open_source(const char* filename);
+void bp_close_source(source_T* source);
+
+#endif
@@ -1,19 +1,27 @@
 #ifndef LEXER_H
 #define LEXER_H
+#include <stddef.h>
+
 #include "token.h"
-#include "semantic.h"
+#include "compiler.h"
+
+// Current token and look ahead
+#define TOKEN_RING_SIZE 2
 
 typedef struct LEXER_STRUCT
 {
+    bp_compiler_T* compiler;
     char current_char;
-    unsigned int start;
-    unsigned int current;
-    char* source;
-    Semantic* sem;
+    const char* source;
+    const char* cursor;     // Points at current_char
+    const char* end;        // One past the last character, always a '\0' sentinel
+    Token tokens[TOKEN_RING_SIZE];
+    unsigned int token_index;
 } lexer_T;
 
-lexer_T* init_lexer(char* contents, Semantic* sem);
+lexer_T* init_lexer(bp_compiler_T* compiler, const char* contents, size_t length);
 
+Token* lexer_init_token(lexer_T* lexer, TokenType type);
 void lexer_advance(lexer_T* lexer);
 
 // Methods to handle blankspace and comments
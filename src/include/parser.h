@@ -1,9 +1,12 @@
 #ifndef PARSER_H
 #define PARSER_H
 #include "lexer.h"
+#include "compiler.h"
 #include "token.h"
 #include "semantic.h"
 #include "error.h"
+#include "ast.h"
+#include "codegen.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -12,7 +15,6 @@
 
 #include <llvm-c/Target.h>
 #include <llvm-c/TargetMachine.h>
-#include <llvm-c/ExecutionEngine.h>
 #include <llvm-c/Target.h>
 #include <llvm-c/Transforms/Scalar.h>
 #include <llvm-c/Core.h>
@@ -21,9 +23,73 @@
 #include <llvm-c/IRReader.h>
 
 
+#define PARSE_STACK_INITIAL_CAPACITY 16
+
+/*
+ * Binary operator levels, lowest binding first
+ */
+typedef enum Precedence {
+    PREC_NONE,
+    PREC_EXPRESSION,    // & |
+    PREC_ARITH_OP,      // + -
+    PREC_RELATION,      // < >= > <= == !=
+    PREC_TERM           // * /
+} Precedence;
+
+/*
+ * Alternatives of <statement>, in the order they are tried
+ */
+typedef enum StatementKind {
+    STMT_ASSIGNMENT,
+    STMT_IF,
+    STMT_LOOP,
+    STMT_RETURN
+} StatementKind;
+
+typedef enum StatementState {
+    STATEMENT_FAILED,
+    STATEMENT_DONE,
+    STATEMENT_OPENED    // A block was opened, its statement list follows
+} StatementState;
+
+/*
+ * Statements of a list being parsed, chained through their next node
+ */
+typedef struct StatementList {
+    NodeIndex head;
+    NodeIndex tail;
+} StatementList;
+
+/*
+ * If or loop statement whose statement list is being parsed
+ */
+typedef struct Block {
+    StatementKind kind;
+    bool in_else;
+    NodeIndex node;                 // The if or loop statement
+    StatementList list;             // Then or else list of an if, body of a loop
+} Block;
+
+/*
+ * Binary operator waiting for its right operand
+ */
+typedef struct PendingOp {
+    Value lhs;
+    TokenType op;
+    Precedence prec;
+} PendingOp;
+
+/*
+ * Parenthesized group of an expression, the whole expression is one too
+ */
+typedef struct ExprGroup {
+    unsigned int base;      // First pending operator of the group
+    bool not_flag;
+} ExprGroup;
 
 typedef struct PARSER_STRUCT
 {
+    bp_compiler_T* compiler;
     lexer_T* lexer;
     Semantic* sem;
     Token* current_token;
@@ -31,9 +97,29 @@ typedef struct PARSER_STRUCT
     bool flag;
     bool table_flag;
     bool jit_flag;
+    bool trace_flag;
+    int jobs;                       // Code generation threads, procedures are emitted after parsing when above 1
+    bool split_units;               // Emit procedures after parsing, each into its own module
+
+    // Bodies are parsed into ast, each one is emitted by codegen once parsed
+    ast_T* ast;
+    codegen_T* codegen;
+
+    // Explicit parse stacks for nested statements and expressions,
+    // a nested call only works above the entries it found
+    Block* blocks;
+    unsigned int block_count;
+    unsigned int block_capacity;
+    PendingOp* ops;
+    unsigned int op_count;
+    unsigned int op_capacity;
+    ExprGroup* groups;
+    unsigned int group_count;
+    unsigned int group_capacity;
 } parser_T;
 
-parser_T* init_parser(lexer_T* lexer, Semantic* sem, bool flag, bool table_flag, bool jit_flag);
+parser_T* init_parser(bp_compiler_T* compiler, lexer_T* lexer, Semantic* sem, bool flag, bool table_flag, bool jit_flag, bool trace_flag, int jobs);
+void free_parser(parser_T* parser);
 bool parser_eat(parser_T* parser, TokenType type);
 
 bool is_token_type(parser_T* parser, TokenType type);
@@ -54,46 +140,50 @@ bool variable_declaration(parser_T* parser, Symbol* decl);
 bool type_mark(parser_T* parser, Symbol* id);
 bool bound(parser_T* parser, Symbol* id);
 
-bool statement(parser_T* parser);
-bool procedure_call(parser_T* parser);
-bool assignment_statement(parser_T* parser);
-bool destination(parser_T* parser, Symbol* id);
-bool if_statement(parser_T* parser);
-bool loop_statement(parser_T* parser);
-bool return_statement(parser_T* parser);
+StatementState statement(parser_T* parser, StatementKind first, NodeIndex* stmt);
+StatementState end_block(parser_T* parser, bool state, NodeIndex* stmt);
+void push_block(parser_T* parser, Block block);
+void append_statement(parser_T* parser, unsigned int base, StatementList* root, NodeIndex stmt);
+bool assignment_statement(parser_T* parser, NodeIndex* stmt);
+bool destination(parser_T* parser, Value* dest);
+bool if_statement(parser_T* parser, Block* block);
+StatementState if_statement_end(parser_T* parser, Block* block);
+bool loop_statement(parser_T* parser, Block* block);
+StatementState loop_statement_end(parser_T* parser, Block* block);
+bool return_statement(parser_T* parser, NodeIndex* stmt);
 
 bool identifier(parser_T* parser, Symbol* id);
 
-bool expression(parser_T* parser, Symbol* exp);
-bool expression_prime(parser_T* parser, Symbol* exp);
-bool arith_op(parser_T* parser, Symbol* op);
-bool arith_op_prime(parser_T* parser, Symbol* ar_op);
-bool relation(parser_T* parser, Symbol* rel);
-bool relation_prime(parser_T* parser, Symbol* rel);
-bool term(parser_T* parser, Symbol* tm);
-bool term_prime(parser_T* parser, Symbol* tm);
-bool factor(parser_T* parser, Symbol* fac);
-
-bool procedure_call_or_name_handler(parser_T* parser, Symbol* id);
-bool name(parser_T* parser, Symbol* id);
-bool array_index(parser_T* parser, Symbol* id, Symbol* ind);
-LLVMValueRef* argument_list(parser_T* parser, Symbol* id);
-bool number(parser_T* parser, Symbol* num);
-bool string(parser_T* parser, Symbol* str);
+bool expression(parser_T* parser, Value* exp);
+Precedence operator_precedence(TokenType type);
+bool reduce_group(parser_T* parser, Value* operand, Precedence prec);
+bool fold_ops(parser_T* parser, unsigned int base, Value* operand, Precedence min_prec);
+void push_group(parser_T* parser);
+void push_op(parser_T* parser, Value lhs, TokenType op, Precedence prec);
+bool factor(parser_T* parser, Value* fac);
+
+bool procedure_call_or_name_handler(parser_T* parser, Value* val);
+bool name(parser_T* parser, Value* val);
+bool array_index(parser_T* parser, Symbol* id, Value* val, Value* ind);
+void name_node(parser_T* parser, NodeKind kind, Symbol* id, Value* val, Value* ind);
+NodeIndex argument_list(parser_T* parser, Symbol* id);
+bool number(parser_T* parser, Value* num);
+bool string(parser_T* parser, Value* str);
 
 bool declaration_list(parser_T* parser);
-bool statement_list(parser_T* parser);
+bool statement_list(parser_T* parser, NodeIndex* list);
 
-bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp);
-bool expression_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op);
-bool arithmetic_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op);
-bool relation_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op);
+bool type_checking(parser_T* parser, Value* dest, Value* exp, Conversion* conv);
+bool expression_type_checking(parser_T* parser, Value* lhs, Value* rhs, Token* op);
+bool arithmetic_type_checking(parser_T* parser, Value* lhs, Value* rhs, Token* op);
+bool relation_type_checking(parser_T* parser, Value* lhs, Value* rhs, Token* op);
+
+void binary_node(parser_T* parser, Value* lhs, Value* rhs, TokenType op, Conversion lhs_conv, Conversion rhs_conv);
+NodeIndex unary_node(parser_T* parser, NodeKind kind, Value* operand);
 
 bool output_bitcode(parser_T* parser);
-LLVMValueRef string_comparison(parser_T* parser, Symbol* lhs, Symbol* rhs);
-void array_assignment_codegen(parser_T* parser, Symbol* dest, Symbol* exp);
-bool array_op_type_check(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op);
-bool name_code_gen(parser_T* parser, Symbol* id, Symbol* ind);
+bool parse_program(parser_T* parser);
+bool array_op_type_check(parser_T* parser, Value* lhs, Value* rhs, Token* op);
 bool resync(parser_T* parser, TokenType tokens[], int count);
 
 #endif
\ No newline at end of file
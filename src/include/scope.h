@@ -1,31 +1,58 @@
 #ifndef SCOPE_H
 #define SCOPE_H
 
-#define MAX_KEYWORD_LENGTH 50
-
 #include "symbol.h"
-#include "uthash.h"
-
-
-typedef struct SymbolTable {
-    char id[MAX_KEYWORD_LENGTH];
-    Symbol entry;
-    UT_hash_handle hh;
-} SymbolTable;
-
-typedef struct Scope {
-    SymbolTable* table;
-    struct Scope* prev_scope;
-} Scope;
-
-Scope* init_scope();
-void free_scope(Scope* scope);
-void set_symbol(Scope* scope, char* s, Symbol sym);
-void update_symbol(Scope* scope, char* s, Symbol sym);
-Symbol get_symbol(Scope* scope, char* id);
-bool has_symbol(Scope* scope, char* id);
-unsigned int symbol_table_size(SymbolTable* table);
-void print_symbol_table(Scope* scope);
-void free_symbol_table(Scope* scope);
-
-#endif
\ No newline at end of file
+
+#define GLOBAL_DEPTH 0
+
+
+/*
+ * A symbol declared in one scope.
+ * shadow is the binding of the same name it hides in an enclosing scope,
+ * so every name has a chain ordered from the innermost scope outwards
+ * and the global binding, if any, is always last.
+ */
+typedef struct Binding {
+    const InternedString* key;
+    int depth;
+    int shadow;
+    Symbol symbol;
+} Binding;
+
+/*
+ * Every scope of the compilation in one table.
+ * The hash index maps a name to the head of its chain, the bindings
+ * themselves live on a stack. Entering a scope records where its
+ * bindings start, exiting pops them and restores each name's shadow,
+ * so both cost nothing beyond the symbols the scope declared.
+ */
+typedef struct ScopeStack {
+    // Hash index, linear probing, capacity is a power of two.
+    // Names stay in the index with head -1 once their last binding is popped
+    const InternedString** slot_keys;
+    int* slot_heads;
+    unsigned int slot_capacity;
+    unsigned int slot_count;
+
+    // Binding stack
+    Binding* bindings;
+    unsigned int count;
+    unsigned int capacity;
+
+    // First binding of each open scope, indexed by depth
+    unsigned int* scope_starts;
+    int depth;
+    int scope_capacity;
+} ScopeStack;
+
+ScopeStack* init_scope_stack();
+void free_scope_stack(ScopeStack* scopes);
+void push_scope(ScopeStack* scopes);
+void pop_scope(ScopeStack* scopes);
+void set_symbol(ScopeStack* scopes, const InternedString* key, Symbol sym, int depth);
+Symbol* get_symbol(ScopeStack* scopes, const InternedString* key, int depth);
+Symbol* lookup_symbol(ScopeStack* scopes, const InternedString* key);
+bool has_symbol(ScopeStack* scopes, const InternedString* key, int depth);
+void print_symbol_table(ScopeStack* scopes, int depth);
+
+#endif
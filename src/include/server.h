@@ -0,0 +1,42 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/un.h>
+
+#define BP_SERVER_MAGIC 0x31435042      // "BPC1"
+#define BP_SERVER_MAX_SOURCE (64u << 20)
+
+/*
+ * Wire format of the compile server, in host byte order since the socket
+ * is local. A request header is followed by the file name and the source,
+ * a response header by the diagnostics and the bitcode. A connection can
+ * carry any number of requests.
+ */
+typedef struct ServerRequest
+{
+    uint32_t magic;
+    uint32_t name_length;
+    uint32_t source_length;
+} ServerRequest;
+
+typedef struct ServerResponse
+{
+    uint32_t status;                // 1 if the program compiled
+    uint32_t diagnostics_length;
+    uint32_t bitcode_length;
+} ServerResponse;
+
+const char* bp_server_socket();
+bool peer_is_user(int fd);
+bool read_all(int fd, void* buffer, size_t length);
+bool write_all(int fd, const void* buffer, size_t length);
+bool socket_address(const char* path, struct sockaddr_un* address);
+int connect_server(const char* path);
+
+int bp_serve(const char* socket_path);
+bool bp_compile_remote(const char* socket_path, const char* src, size_t length, const char* name, const char* output, int* exit_status);
+
+#endif
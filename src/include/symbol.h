@@ -6,8 +6,10 @@
 #include <llvm-c/Core.h>
 
 #include "token.h"
+#include "arena.h"
+#include "compiler.h"
 
-struct SymbolNode;
+struct ParamList;
 
 /*
  * Variable type or return type of procedure
@@ -39,41 +41,40 @@ typedef enum SymbolType {
  */
 typedef struct Symbol {
     char* id;
+    const InternedString* name;     // Symbol table key, name->str for identifiers
     TokenType ttype;
     SymbolType stype;
     TypeClass type;
     bool is_global;
     bool is_arr;
     int arr_size;
-    bool is_indexed;
-    bool is_not_empty;
-    struct SymbolNode* params;
+    struct ParamList* params;       // NULL until the first parameter is added
 
     // LLVM Values
-    LLVMValueRef llvm_value;
     LLVMValueRef llvm_function;
     LLVMValueRef llvm_address;
 
 } Symbol;
 
 /*
- * Linked list implementation for symbols
+ * Parameters of a procedure, stored inline after the count
+ * so the nth parameter is a single index
  */
-typedef struct SymbolNode {
-    Symbol symbol;
-    struct SymbolNode* next_symbol;
-} SymbolNode;
+typedef struct ParamList {
+    int count;
+    int capacity;
+    Symbol items[];
+} ParamList;
 
-Symbol* init_symbol();
-Symbol* init_symbol_with_id(char* id_name, TokenType token_type);
-Symbol* init_symbol_with_id_symbol_type(char* id_name, TokenType token_type, SymbolType sym_type, TypeClass type_c);
-Symbol get_nth_param(Symbol* sym, int idx);
+Symbol* init_symbol(bp_compiler_T* compiler);
+Symbol* init_symbol_with_id(bp_compiler_T* compiler, char* id_name, TokenType token_type);
+Symbol* init_symbol_with_id_symbol_type(bp_compiler_T* compiler, char* id_name, TokenType token_type, SymbolType sym_type, TypeClass type_c);
+void add_param(bp_compiler_T* compiler, Symbol* sym, Symbol param);
+Symbol* get_nth_param(Symbol* sym, int idx);
 int params_size(Symbol* sym);
-void free_symbol(Symbol* sym);
-void free_params_list(SymbolNode* head);
 char* print_symbol_type(SymbolType type);
 char* print_type_class(TypeClass type);
 
-LLVMTypeRef create_llvm_type(TypeClass entry_type);
+LLVMTypeRef create_llvm_type(bp_compiler_T* compiler, TypeClass entry_type);
 
 #endif
\ No newline at end of file
@@ -2,8 +2,10 @@
 #define TOKEN_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "custom.h"
+#include "intern.h"
 
 #define MAX_STRING_LENGTH 50
 
@@ -66,6 +68,7 @@ typedef struct
     union
     {
         char stringVal[MAX_STRING_LENGTH];
+        const InternedString* idVal;
         int intVal;
         float floatVal;
         bool boolVal;
@@ -73,7 +76,7 @@ typedef struct
     } value;
 } Token;
 
-Token* init_token(TokenType type);
-void to_lower_case_str(char *p);
+Token* init_token(Token* token, TokenType type);
+TokenType lookup_reserved_word(const char* str, size_t length);
 char* print_token(Token* token);
 #endif
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "include/intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define INTERN_INITIAL_CAPACITY 1024
+
+/*
+ * FNV-1a, optionally over the lowercased bytes
+ */
+static unsigned int hash_string(const char* str, size_t length, bool fold_case)
+{
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = str[i];
+        hash ^= fold_case ? tolower(c) : c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool string_equals(const InternedString* entry, const char* str, size_t length, bool fold_case)
+{
+    if (entry->length != length)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = str[i];
+        if (entry->str[i] != (fold_case ? tolower(c) : c))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void grow_pool(InternPool* pool)
+{
+    unsigned int capacity = pool->capacity == 0 ? INTERN_INITIAL_CAPACITY : pool->capacity * 2;
+    const InternedString** slots = calloc(capacity, sizeof(InternedString*));
+
+    for (unsigned int i = 0; i < pool->capacity; i++)
+    {
+        const InternedString* entry = pool->slots[i];
+        if (entry != NULL)
+        {
+            unsigned int idx = entry->hash & (capacity - 1);
+            while (slots[idx] != NULL)
+            {
+                idx = (idx + 1) & (capacity - 1);
+            }
+            slots[idx] = entry;
+        }
+    }
+
+    free(pool->slots);
+    pool->slots = slots;
+    pool->capacity = capacity;
+}
+
+/*
+ * Return the unique handle for str.
+ * With fold_case the string is matched and stored lowercased,
+ * which is how identifiers are made case insensitive.
+ */
+const InternedString* intern_string(InternPool* pool, const char* str, size_t length, bool fold_case)
+{
+    // Keep the load factor under 1/2
+    if ((pool->count + 1) * 2 > pool->capacity)
+    {
+        grow_pool(pool);
+    }
+
+    unsigned int hash = hash_string(str, length, fold_case);
+    unsigned int idx = hash & (pool->capacity - 1);
+
+    while (pool->slots[idx] != NULL)
+    {
+        const InternedString* entry = pool->slots[idx];
+        if (entry->hash == hash && string_equals(entry, str, length, fold_case))
+        {
+            return entry;
+        }
+        idx = (idx + 1) & (pool->capacity - 1);
+    }
+
+    InternedString* entry = malloc(sizeof(InternedString) + length + 1);
+    entry->hash = hash;
+    entry->length = length;
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = str[i];
+        entry->str[i] = fold_case ? tolower(c) : c;
+    }
+    entry->str[length] = '\0';
+
+    pool->slots[idx] = entry;
+    pool->count++;
+    return entry;
+}
+
+const InternedString* intern_cstr(InternPool* pool, const char* str)
+{
+    return intern_string(pool, str, strlen(str), false);
+}
+
+/*
+ * Release every interned string, all handles become invalid
+ */
+void free_intern_pool(InternPool* pool)
+{
+    for (unsigned int i = 0; i < pool->capacity; i++)
+    {
+        free((void*) pool->slots[i]);
+    }
+    free(pool->slots);
+    pool->slots = NULL;
+    pool->capacity = 0;
+    pool->count = 0;
+}
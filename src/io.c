@@ -2,37 +2,171 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define READ_CHUNK_SIZE 65536
 
 
 /*
- * Helper function for reading in source file
+ * Map a regular file read-only.
+ * An anonymous region one byte larger than the file is reserved first
+ * and the file is mapped over its start, so the byte after the last
+ * character is always a zero filled sentinel even when the file size
+ * is an exact multiple of the page size.
  */
-char* bp_read_file(const char* filename)
+static bool map_source(source_T* source, int fd, size_t size)
 {
-    FILE* fp;
-    char* line = NULL;
-    size_t len = 0;
-    ssize_t read;
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t mapped_size = ((size + 1 + page_size - 1) / page_size) * page_size;
+
+    char* region = mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        return false;
+    }
+
+    if (size > 0 && mmap(region, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(region, mapped_size);
+        return false;
+    }
+
+    madvise(region, mapped_size, MADV_SEQUENTIAL);
+
+    source->contents = region;
+    source->length = size;
+    source->mapped_size = mapped_size;
+    source->is_mapped = true;
+    return true;
+}
+
+/*
+ * Fallback for pipes, stdin and files that cannot be mapped.
+ * Known sizes are read with a single sized read, unknown sizes
+ * grow the buffer geometrically so reading stays linear.
+ */
+static bool read_source(source_T* source, int fd, size_t size_hint)
+{
+    size_t capacity = (size_hint > 0 ? size_hint : READ_CHUNK_SIZE) + 1;
+    size_t length = 0;
+    char* buffer = malloc(capacity);
+    ssize_t n;
+
+    if (buffer == NULL)
+    {
+        return false;
+    }
+
+    for (;;)
+    {
+        if (length + 1 == capacity)
+        {
+            capacity *= 2;
+            char* tmp = realloc(buffer, capacity);
+            if (tmp == NULL)
+            {
+                free(buffer);
+                return false;
+            }
+            buffer = tmp;
+        }
+
+        n = read(fd, buffer + length, capacity - length - 1);
+        if (n < 0)
+        {
+            free(buffer);
+            return false;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        length += n;
+    }
+
+    buffer[length] = '\0';
+    source->contents = buffer;
+    source->length = length;
+    source->mapped_size = 0;
+    source->is_mapped = false;
+    return true;
+}
 
-    fp = fopen(filename, "rb");
-    if (fp == NULL)
+/*
+ * Open a source file for the lexer.
+ * A file name of "-" reads the program from stdin.
+ */
+source_T* bp_open_source(const char* filename)
+{
+    source_T* source = bp_try_open_source(filename);
+    if (source == NULL)
     {
         printf("Could not read file `%s`\n", filename);
         exit(1);
     }
+    return source;
+}
 
-    char* buffer = (char*) calloc(1, sizeof(char));
-    buffer[0] = '\0';
+/*
+ * Like bp_open_source, but NULL if the file cannot be read
+ */
+source_T* bp_try_open_source(const char* filename)
+{
+    source_T* source = calloc(1, sizeof(struct SOURCE_STRUCT));
+    bool use_stdin = strcmp(filename, "-") == 0;
+    int fd = use_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+    struct stat st;
 
-    while ((read = getline(&line, &len, fp)) != -1)
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        if (fd >= 0 && !use_stdin)
+        {
+            close(fd);
+        }
+        free(source);
+        return NULL;
+    }
+
+    bool loaded = false;
+    if (S_ISREG(st.st_mode))
+    {
+        loaded = map_source(source, fd, st.st_size) || read_source(source, fd, st.st_size);
+    }
+    else
     {
-        buffer = (char*) realloc(buffer, (strlen(buffer) + strlen(line) + 1) * sizeof(char));
-        strcat(buffer, line);
+        loaded = read_source(source, fd, 0);
     }
 
-    fclose(fp);
-    if (line)
-        free(line);
-    
-    return buffer;
-}
\ No newline at end of file
+    if (!use_stdin)
+    {
+        close(fd);
+    }
+
+    if (!loaded)
+    {
+        free(source);
+        return NULL;
+    }
+
+    return source;
+}
+
+void bp_close_source(source_T* source)
+{
+    if (source != NULL)
+    {
+        if (source->is_mapped)
+        {
+            munmap((void*) source->contents, source->mapped_size);
+        }
+        else
+        {
+            free((void*) source->contents);
+        }
+        free(source);
+        source = NULL;
+    }
+}
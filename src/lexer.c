@@ -1,20 +1,34 @@
 #include "include/lexer.h"
+#include "include/error.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 
-lexer_T* init_lexer(char* source, Semantic* sem)
+lexer_T* init_lexer(bp_compiler_T* compiler, const char* source, size_t length)
 {
     lexer_T* lexer = calloc(1, sizeof(struct LEXER_STRUCT));
+    lexer->compiler = compiler;
     lexer->source = source;
-    lexer->sem = sem;
-    lexer->start = 0;
-    lexer->current_char = source[lexer->start];
+    lexer->cursor = source;
+    lexer->end = source + length;
+    lexer->current_char = *lexer->cursor;
 
     return lexer;
 }
 
+/*
+ * Hand out the next token slot.
+ * The parser only holds the current token and the look ahead,
+ * so the slots are recycled in turn instead of allocating a token each time.
+ */
+Token* lexer_init_token(lexer_T* lexer, TokenType type)
+{
+    Token* token = &lexer->tokens[lexer->token_index];
+    lexer->token_index = (lexer->token_index + 1) % TOKEN_RING_SIZE;
+    return init_token(token, type);
+}
+
 // Lexer main function to detect each type of tokens
 Token* lexer_get_next_token(lexer_T* lexer)
 {
@@ -37,7 +51,7 @@ Token* lexer_get_next_token(lexer_T* lexer)
                     lexer_skip_block_comment(lexer);
                     return  lexer_get_next_token(lexer);
                 default:
-                    return init_token(T_DIVIDE);
+                    return lexer_init_token(lexer, T_DIVIDE);
             }
         
         case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H':
@@ -50,7 +64,7 @@ Token* lexer_get_next_token(lexer_T* lexer)
         case 'y': case 'z':
             return lexer_collect_id(lexer);
         
-        case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '9':
+        case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
             return lexer_collect_integer(lexer);
         case '"':
             return lexer_collect_string(lexer);
@@ -58,101 +72,101 @@ Token* lexer_get_next_token(lexer_T* lexer)
             lexer_advance(lexer);
             if (lexer->current_char != EOF && lexer->current_char == '=')
             {
-                token = init_token(T_ASSIGNMENT);
+                token = lexer_init_token(lexer, T_ASSIGNMENT);
                 lexer_advance(lexer);
             }
             else
-                token = init_token(T_COLON);
+                token = lexer_init_token(lexer, T_COLON);
             return token;
         case '+':
-            token = init_token(T_PLUS);
+            token = lexer_init_token(lexer, T_PLUS);
             lexer_advance(lexer);
             return token;
         case '-':
-            token = init_token(T_MINUS);
+            token = lexer_init_token(lexer, T_MINUS);
             lexer_advance(lexer);
             return token;
         case '*':
-            token = init_token(T_MULTIPLY);
+            token = lexer_init_token(lexer, T_MULTIPLY);
             lexer_advance(lexer);
             return token;
         case '=':
             lexer_advance(lexer);
             if (lexer->current_char != EOF && lexer->current_char == '=')
             {
-                token = init_token(T_EQ);
+                token = lexer_init_token(lexer, T_EQ);
                 lexer_advance(lexer);
                 return token;
             }
             else
             {
-                token = init_token(T_UNKNOWN);
-                printf("Unknown token!\n");
+                token = lexer_init_token(lexer, T_UNKNOWN);
+                report_diagnostic(lexer->compiler, "Unknown token!\n");
                 return token;
             }
         case '!':
             lexer_advance(lexer);
             if (lexer->current_char != EOF && lexer->current_char == '=')
             {
-                token = init_token(T_NOT_EQ);
+                token = lexer_init_token(lexer, T_NOT_EQ);
                 lexer_advance(lexer);
                 return token;
             }
             else
             {
-                token = init_token(T_UNKNOWN);
+                token = lexer_init_token(lexer, T_UNKNOWN);
                 return token;
             }
         case '<':
             lexer_advance(lexer);
             if (lexer->current_char != EOF && lexer->current_char == '=')
             {
-                token = init_token(T_LTEQ);
+                token = lexer_init_token(lexer, T_LTEQ);
                 lexer_advance(lexer);
             }
             else
-                token = init_token(T_LT);
+                token = lexer_init_token(lexer, T_LT);
             return token;
         case '>':
             lexer_advance(lexer);
             if (lexer->current_char != EOF && lexer->current_char == '=')
             {
-                token = init_token(T_GTEQ);
+                token = lexer_init_token(lexer, T_GTEQ);
                 lexer_advance(lexer);
             }
             else
-                token = init_token(T_GT);
+                token = lexer_init_token(lexer, T_GT);
             return token;
         case ';':
-            token = init_token(T_SEMI_COLON);
+            token = lexer_init_token(lexer, T_SEMI_COLON);
             lexer_advance(lexer);
             return token;
         case '(':
-            token = init_token(T_LPAREN);
+            token = lexer_init_token(lexer, T_LPAREN);
             lexer_advance(lexer);
             return token;
         case ')':
-            token = init_token(T_RPAREN);
+            token = lexer_init_token(lexer, T_RPAREN);
             lexer_advance(lexer);
             return token;
         case '[':
-            token = init_token(T_LBRACKET);
+            token = lexer_init_token(lexer, T_LBRACKET);
             lexer_advance(lexer);
             return token;
         case ']':
-            token = init_token(T_RBRACKET);
+            token = lexer_init_token(lexer, T_RBRACKET);
             lexer_advance(lexer);
             return token;
         case ',':
-            token = init_token(T_COMMA);
+            token = lexer_init_token(lexer, T_COMMA);
             lexer_advance(lexer);
             return token;
         case EOF:
         case '.':
-            return init_token(T_EOF);
+            return lexer_init_token(lexer, T_EOF);
         default:
-            token = init_token(T_UNKNOWN);
-            printf("Invalid input!\n");
+            token = lexer_init_token(lexer, T_UNKNOWN);
+            report_diagnostic(lexer->compiler, "Invalid input!\n");
             lexer_advance(lexer);
             return token;
     }
@@ -163,7 +177,7 @@ Token* lexer_collect_string(lexer_T* lexer)
     // Eat the double quote character
     lexer_advance(lexer);
 
-    Token* token = init_token(T_STRING);
+    Token* token = lexer_init_token(lexer, T_STRING);
     int cnt = 0;
 
     while (lexer->current_char != EOF && (
@@ -185,7 +199,7 @@ Token* lexer_collect_string(lexer_T* lexer)
 
     if (cnt > MAX_STRING_LENGTH)
     {
-        printf("String too long\n");
+        report_diagnostic(lexer->compiler, "String too long\n");
         return token;
     }
 
@@ -205,7 +219,7 @@ Token* lexer_collect_string(lexer_T* lexer)
 
 Token* lexer_collect_integer(lexer_T* lexer)
 {
-    Token* token = init_token(T_NUMBER_INT);
+    Token* token = lexer_init_token(lexer, T_NUMBER_INT);
     token->value.intVal = 0;
     token->value.intVal = lexer->current_char - '0';
 
@@ -242,31 +256,38 @@ Token* lexer_collect_float(lexer_T** lexer, Token** token)
 
 Token* lexer_collect_id(lexer_T* lexer)
 {   
-    int i = 0;
-    Token* token = init_token(T_ID);
+    Token* token = lexer_init_token(lexer, T_ID);
+    const char* begin = lexer->cursor;
 
-    for (i = 0; isalnum(lexer->current_char) || lexer->current_char == '_'; i++)
+    while (isalnum(lexer->current_char) || lexer->current_char == '_')
     {
-        if (i == MAX_STRING_LENGTH)
-        {
-            printf("Identifier is too long!\n");
-            return token;
-        }
-        token->value.stringVal[i] = lexer->current_char;
         lexer_advance(lexer);
     }
 
-    to_lower_case_str(token->value.stringVal);
-    token->type = check_for_reserved_word(lexer->sem, (char*)token->value.stringVal);
+    size_t length = lexer->cursor - begin;
+
+    // Keywords are classified straight from the source bytes
+    token->type = lookup_reserved_word(begin, length);
+
+    // Identifiers are case insensitive, intern them lowercased
+    if (token->type == T_ID)
+    {
+        token->value.idVal = intern_string(&lexer->compiler->pool, begin, length, true);
+    }
     return token;
 }
 
+/*
+ * Move to the next character.
+ * The buffer is terminated by a '\0' sentinel at end,
+ * so reaching the end leaves current_char at '\0'.
+ */
 void lexer_advance(lexer_T* lexer)
 {
-    if (lexer->current_char != '\0' && lexer->start < strlen(lexer->source))
+    if (lexer->cursor < lexer->end)
     {
-        lexer->start += 1;
-        lexer->current_char = lexer->source[lexer->start];
+        lexer->cursor += 1;
+        lexer->current_char = *lexer->cursor;
     }
 }
 
@@ -313,5 +334,5 @@ void lexer_skip_block_comment(lexer_T* lexer)
         }
     }
     if (cnt > 0)
-        printf("Comment error, did not end properly!\n");
+        report_diagnostic(lexer->compiler, "Comment error, did not end properly!\n");
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "include/bp.h"
+#include "include/server.h"
+#include "include/io.h"
+#include "include/cache.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -8,42 +12,182 @@ int main(int argc, char *argv[])
     if (argc < 2)
     {
         printf("usage: ./bp.out [OPTIONS] <file name>\n");
+        printf("       ./bp.out --batch [-j N] <file name | @manifest>...\n");
+        printf("       ./bp.out --run <file name>\n");
+        printf("       ./bp.out --serve [socket]\n");
+        printf("       ./bp.out --cache-stats\n");
         printf("%s",
             "Options:\n"
             "  -dp          Debug statements from parser.\n"
             "  -dt          Debug output from symbol table.\n"
             "  -dm          Debug output from LLVM JIT compiler.\n"
+            "  -dr          Dump the last parser events when parsing fails.\n"
+            "  -O0 ... -O3  Optimize the program, -Os and -Oz for size (default: -O0).\n"
+            "  -c           Write a native object, dist/result.o unless -o is given.\n"
+            "  -o FILE      Link an executable, or name the object of -c.\n"
+            "  -march=CPU   Generate code for CPU, native for the host's (default: generic).\n"
+            "  -j N         Emit procedure bodies on N threads after parsing.\n"
+            "               With --batch, compile N files at once (default: all CPUs).\n"
+            "  --batch      Compile every file to a .bc next to it, LLVM is set up once.\n"
+            "  --run        Run the program, compiling each procedure when it is first called.\n"
+            "  --serve      Compile requests from a socket, $BP_SERVER or bp.sock in\n"
+            "               $XDG_RUNTIME_DIR (default: /tmp/bp-<uid>/bp.sock).\n"
+            "               Plain compilations use the server when it is running.\n"
+            "  --cache-stats Print the hits and misses of the compilation cache.\n"
         );
         return 1;
     }
 
-    bool parser_flag = false, table_flag = false, jit_flag = false;
-    int counter = 1;
-    for (int i = 0; i < argc; i++)
+    bool parser_flag = false, table_flag = false, jit_flag = false, trace_flag = false;
+    bool batch = false, serve = false, run = false, cache_stats = false;
+    int jobs = 0;
+    const char* opt_level = NULL;
+    const char* cpu = NULL;
+    const char* output = NULL;
+    bool object = false;
+
+    // Positional arguments, the file names. `-` is stdin.
+    char** inputs = malloc(argc * sizeof(char*));
+    int input_count = 0;
+    for (int i = 1; i < argc; i++)
     {
-        if (argv[i][0] == '-')
+        if (argv[i][0] != '-' || argv[i][1] == '\0')
+        {
+            inputs[input_count++] = argv[i];
+        }
+        else if (strcmp(argv[i], "--batch") == 0)
+        {
+            batch = true;
+        }
+        else if (strcmp(argv[i], "--serve") == 0)
+        {
+            serve = true;
+        }
+        else if (strcmp(argv[i], "--run") == 0)
+        {
+            run = true;
+        }
+        else if (strcmp(argv[i], "--cache-stats") == 0)
+        {
+            cache_stats = true;
+        }
+        else if (strncmp(argv[i], "-march=", strlen("-march=")) == 0)
+        {
+            cpu = argv[i] + strlen("-march=");
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            object = true;
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else
         {
             if (argv[i][1] == 'd')
             {
                 if (argv[i][2] == 'p')
                 {
                     parser_flag = true;
-                    counter++;
                 }
                 else if (argv[i][2] == 't')
                 {
                     table_flag = true;
-                    counter++;
                 }
                 else if (argv[i][2] == 'm')
                 {
                     jit_flag = true;
-                    counter++;
+                }
+                else if (argv[i][2] == 'r')
+                {
+                    trace_flag = true;
+                }
+            }
+            else if (argv[i][1] == 'O')
+            {
+                if (argv[i][2] == '\0' || argv[i][3] != '\0' || strchr("0123sz", argv[i][2]) == NULL)
+                {
+                    printf("Unknown optimization level `%s`\n", argv[i]);
+                    free(inputs);
+                    return 1;
+                }
+
+                // -O0 writes the module as emitted, which is the default
+                opt_level = argv[i][2] == '0' ? NULL : &argv[i][1];
+            }
+            else if (argv[i][1] == 'j')
+            {
+                // Either -j N or -jN
+                if (argv[i][2] == '\0' && i + 1 < argc)
+                {
+                    jobs = atoi(argv[++i]);
+                }
+                else
+                {
+                    jobs = atoi(&argv[i][2]);
                 }
             }
         }
     }
 
-    bp_compile_file(argv[counter], parser_flag, table_flag, jit_flag);
-    return 0;
+    // Only a batch compiles several files, a server takes its socket
+    if (!batch && input_count > 1)
+    {
+        printf("Expected one file name, got `%s` and `%s`\n", inputs[0], inputs[1]);
+        free(inputs);
+        return 1;
+    }
+
+    // Options that would otherwise be ignored
+    if ((serve && (opt_level != NULL || cpu != NULL)) || ((batch || serve || run) && (object || output != NULL)))
+    {
+        printf("%s", serve && (opt_level != NULL || cpu != NULL)
+            ? "-O and -march do not apply to --serve, clients that use them compile locally\n"
+            : "-c and -o only apply to the compilation of one file\n");
+        free(inputs);
+        return 1;
+    }
+
+    int status = 0;
+    if (batch)
+    {
+        status = bp_compile_batch(inputs, input_count, jobs, opt_level, cpu) > 0 ? 1 : 0;
+    }
+    else if (serve)
+    {
+        status = bp_serve(input_count > 0 ? inputs[0] : bp_server_socket());
+    }
+    else if (run && input_count > 0)
+    {
+        source_T* src = bp_open_source(inputs[0]);
+        status = bp_run(src->contents, src->length, inputs[0], opt_level, cpu);
+        bp_close_source(src);
+    }
+    else if (input_count > 0)
+    {
+        // -c writes an object, -o alone an executable
+        bp_output_T output_kind = object ? BP_OUTPUT_OBJECT : output != NULL ? BP_OUTPUT_EXECUTABLE : BP_OUTPUT_BITCODE;
+        if (output == NULL)
+        {
+            output = object ? "dist/result.o" : "dist/result.bc";
+        }
+
+        // The server only writes generic bitcode, everything else is compiled here
+        bool debug = parser_flag || table_flag || jit_flag || trace_flag;
+        bool local = debug || jobs > 0 || opt_level != NULL || cpu != NULL || output_kind != BP_OUTPUT_BITCODE;
+        source_T* src = bp_open_source(inputs[0]);
+        if (local || !bp_compile_remote(bp_server_socket(), src->contents, src->length, inputs[0], output, &status))
+        {
+            status = bp_compile(src->contents, src->length, inputs[0], output, parser_flag, table_flag, jit_flag, trace_flag, jobs > 0 ? jobs : 1, opt_level, output_kind, cpu) ? 0 : 1;
+        }
+        bp_close_source(src);
+    }
+    free(inputs);
+
+    if (cache_stats)
+    {
+        print_cache_stats();
+    }
+    return status;
 }
\ No newline at end of file
@@ -1,62 +1,72 @@
 #include "include/parser.h"
 
-LLVMBuilderRef llvm_builder;
-LLVMModuleRef llvm_module;
-LLVMExecutionEngineRef llvm_engine;
-LLVMContextRef llvm_context;
-LLVMValueRef main_func;
-
-LLVMTypeRef int32_type;
-LLVMTypeRef int8_type;
-LLVMTypeRef int1_type;
-LLVMTypeRef float_type;
-
-
-bool error_flag;
-
 
 /*
  * Parser constructor
  */
-parser_T* init_parser(lexer_T* lexer, Semantic* sem, bool flag, bool table_flag, bool jit_flag)
+parser_T* init_parser(bp_compiler_T* compiler, lexer_T* lexer, Semantic* sem, bool flag, bool table_flag, bool jit_flag, bool trace_flag, int jobs)
 {
     parser_T* parser = calloc(1, sizeof(struct PARSER_STRUCT));
+    parser->compiler = compiler;
     parser->lexer = lexer;
     parser->sem = sem;
     parser->current_token = (void*) 0;
     parser->look_ahead = lexer_get_next_token(lexer);
 
-    error_flag = false;
+    compiler->error_flag = false;
     parser->flag = flag;
     parser->table_flag = table_flag;
     parser->jit_flag = jit_flag;
+    parser->trace_flag = trace_flag;
+    parser->jobs = jobs;
+    parser->ast = init_ast();
+    parser->codegen = init_codegen(compiler, sem, parser->ast);
     return parser;
 }
 
+void free_parser(parser_T* parser)
+{
+    if (parser != NULL)
+    {
+        free(parser->blocks);
+        free(parser->ops);
+        free(parser->groups);
+        free_codegen(parser->codegen);
+        free_ast(parser->ast);
+        free(parser);
+    }
+}
+
 /*
  * Eat/consume a token and look ahead the next one
  */
 bool parser_eat(parser_T* parser, TokenType type)
 {
-    Token* tmp = init_token(type);
-    debug_parser_statement("Matching token. Expected type: ", parser->flag);
-    debug_parser_statement(concatf("%s", print_token(tmp)), parser->flag);
+    Token tmp;
+    debug_parser(parser->flag, "Matching token. Expected type: ");
+    debug_parser(parser->flag, "%s", print_token(init_token(&tmp, type)));
 
     if (!is_token_type(parser, type))
     {
-        debug_parser_statement(concatf("Token doesn't match. Current look ahead is: %s", print_token(parser->look_ahead)), parser->flag);
+        if (parser->trace_flag)
+        {
+            trace_parser_event(parser->compiler, "mismatch", type, parser->look_ahead);
+        }
+        debug_parser(parser->flag, "Token doesn't match. Current look ahead is: %s", print_token(parser->look_ahead));
         return false;
     }
     else
     {
-        debug_parser_statement(concatf("Token matched. Current look ahead is: %s", print_token(parser->look_ahead)), parser->flag);
+        if (parser->trace_flag)
+        {
+            trace_parser_event(parser->compiler, "matched", type, parser->look_ahead);
+        }
+        debug_parser(parser->flag, "Token matched. Current look ahead is: %s", print_token(parser->look_ahead));
         parser->current_token = parser->look_ahead;
         parser->look_ahead = lexer_get_next_token(parser->lexer);
-        debug_parser_statement(concatf("Current token: %sLook ahead is: %s\n", print_token(parser->current_token), print_token(parser->look_ahead)), parser->flag);
+        debug_parser(parser->flag, "Current token: %sLook ahead is: %s\n", print_token(parser->current_token), print_token(parser->look_ahead));
         return true;
     }
-
-    free(tmp);
 }
 
 /*
@@ -78,14 +88,14 @@ bool resync(parser_T* parser, TokenType tokens[], int count)
 {
     TokenType always_check_token = T_EOF;
 
-    while (error_flag)
+    while (parser->compiler->error_flag)
     {
         // Check if the current token is in either array
         for (int i = 0; i < count; i++)
         {
             if (parser->look_ahead->type == tokens[i])
             {
-                error_flag = false;
+                parser->compiler->error_flag = false;
                 break;
             }
         }
@@ -96,6 +106,10 @@ bool resync(parser_T* parser, TokenType tokens[], int count)
         }
 
         // Ignore current token and scan the next one
+        if (parser->trace_flag)
+        {
+            trace_parser_event(parser->compiler, "skipped", parser->look_ahead->type, parser->look_ahead);
+        }
         parser->current_token = parser->look_ahead;
         parser->look_ahead = lexer_get_next_token(parser->lexer);
     }
@@ -105,114 +119,108 @@ bool resync(parser_T* parser, TokenType tokens[], int count)
 bool output_bitcode(parser_T* parser)
 {
     // Initialize
-    LLVMLinkInMCJIT();
-    LLVMLinkInInterpreter();
-    LLVMInitializeNativeTarget();
-    LLVMInitializeNativeAsmPrinter();
-    LLVMInitializeNativeAsmParser();
-
-    // Get triple
-    char* triple = LLVMGetDefaultTargetTriple();
-    LLVMTargetRef target_ref;
-    char* err;
-
-    if (LLVMGetTargetFromTriple(triple, &target_ref, &err))
-    {
-        throw_error(concatf("Error: %s\n", err), parser->look_ahead);
-        return 1;
-    }
-
-    LLVMTargetMachineRef tm_ref = LLVMCreateTargetMachine(
-        target_ref,              // 
-        triple,                  // 
-        "generic",               // const char* cpu
-        "",                      // const char* features
-        LLVMCodeGenLevelDefault, // level
-        LLVMRelocStatic,         // reloc
-        LLVMCodeModelJITDefault  // code model
-    );
-    LLVMDisposeMessage(triple);
-
-    // Create context
-    llvm_context = LLVMContextCreate();
-
-    // Types in context
-    int32_type = LLVMInt32TypeInContext(llvm_context);
-    int8_type = LLVMInt8TypeInContext(llvm_context);
-    int1_type = LLVMInt1TypeInContext(llvm_context);
-    float_type = LLVMFloatTypeInContext(llvm_context);
-
-    // Create builder
-    // Create and position builder
-    llvm_builder = LLVMCreateBuilderInContext(llvm_context);
-
-    debug_parser_statement("\nStart parsing....\n", parser->flag);
-    bool status = parse(parser);
-    if (!status)
+    initialize_llvm();
+
+    // Generic unless -march picks a CPU
+    LLVMTargetMachineRef tm_ref = codegen_target_machine(parser->compiler);
+    char* err = NULL;
+    if (tm_ref == NULL)
+    {
+        return false;
+    }
+
+    // Create context, types and builder
+    codegen_context(parser->compiler, LLVMContextCreate());
+
+    // A failure returns instead of exiting, so the caller can clean up its files
+    bool written = parse_program(parser);
+
+    // Errors the parser recovered from get their trace too
+    if (parser->trace_flag && (!written || parser->compiler->error_count > 0))
+    {
+        dump_parser_trace(parser->compiler);
+    }
+    if (!written)
     {
         printf("Failed to parse the program. Exiting...\n");
-        // Cleanup
-        LLVMDisposeBuilder(llvm_builder);
-        LLVMDisposeModule(llvm_module);
-        LLVMContextDispose(llvm_context);
-        exit(1);
     }
 
-    if (parser->jit_flag)
+    if (written && parser->jit_flag)
     {
         printf("Printing out module (before compilation success):\n");
-        printf("%s", LLVMPrintModuleToString(llvm_module));
+        printf("%s", LLVMPrintModuleToString(parser->compiler->module));
     }
 
     //--- Analysis and execution
 
     // Verify the module
     err = NULL;
-
-    LLVMVerifyModule(llvm_module, LLVMAbortProcessAction, &err);
+    if (written && LLVMVerifyModule(parser->compiler->module, LLVMReturnStatusAction, &err))
+    {
+        report_diagnostic(parser->compiler, "%s:\nERROR: %s\n", parser->compiler->file_name, err);
+        written = false;
+    }
     LLVMDisposeMessage(err);
 
-    // Build executor
-    err         = NULL;
-    llvm_engine = NULL;
-
-    if (LLVMCreateExecutionEngineForModule(&llvm_engine, llvm_module, &err) != 0)
+    // Optimize before the module is written, a failed pipeline writes nothing
+    if (written)
     {
-        fprintf(stderr, "Failed to create execution engine\n");
-        abort();
+        written = codegen_optimize(parser->compiler, parser->compiler->module, tm_ref);
     }
 
-    if (err)
+    // Write out bitcode to file, or compile it for the target machine
+    if (written && parser->compiler->output_kind != BP_OUTPUT_BITCODE)
     {
-        fprintf(stderr, "Error: %s\n", err);
-        LLVMDisposeMessage(err);
-        exit(EXIT_FAILURE);
+        written = codegen_emit_object(parser->compiler, tm_ref, parser->compiler->output_name);
     }
-
-    // Write out bitcode to file
-    if (LLVMWriteBitcodeToFile(llvm_module, "dist/result.bc") != 0) {
+    else if (written && LLVMWriteBitcodeToFile(parser->compiler->module, parser->compiler->output_name) != 0) {
         fprintf(stderr, "error writing bitcode to file, skipping\n");
-    }
-
-
-    if (err)
-    {
-        fprintf(stderr, "Error: %s\n", err);
-        LLVMDisposeMessage(err);
+        written = false;
     }
 
     // Dump module
     // fprintf(stderr, "\n--- Module ---\n");
 
-    // LLVMDumpModule(llvm_module);
+    // LLVMDumpModule(parser->compiler->module);
 
     // fprintf(stderr, "--------------\n");
 
     // Cleanup
-    LLVMDisposeBuilder(llvm_builder);
-    LLVMDisposeModule(llvm_module);
-    LLVMContextDispose(llvm_context);
-    return true;
+    LLVMDisposeTargetMachine(tm_ref);
+    codegen_dispose_context(parser->compiler);
+    return written;
+}
+
+/*
+ * Parse the program into the module of the compiler, whose context is set up.
+ * Returns false if parsing stopped or the procedures emitted on -j threads
+ * could not be linked, errors it recovered from are only counted.
+ */
+bool parse_program(parser_T* parser)
+{
+    debug_parser(parser->flag, "\nStart parsing....\n");
+    bool status = parse(parser);
+
+    // With -j or split units the procedures are only captured while parsing
+    if (status && (parser->jobs > 1 || parser->split_units))
+    {
+        if (parser->split_units)
+        {
+            codegen_split_units(parser->codegen);
+        }
+        else
+        {
+            status = codegen_procedure_units(parser->codegen, parser->jobs);
+        }
+        for (unsigned int i = 0; status && i < parser->codegen->unit_count; i++)
+        {
+            if (!parser->codegen->units[i].valid)
+            {
+                throw_error(parser->compiler, "Function does not have a return value.\n", parser->look_ahead);
+            }
+        }
+    }
+    return status;
 }
 
 // Holy entry point
@@ -232,13 +240,10 @@ bool program(parser_T* parser)
     }
 
     // Main entry code block
-    LLVMTypeRef return_type   = LLVMVoidTypeInContext(llvm_context);
-    LLVMTypeRef main_func_type = LLVMFunctionType(return_type, NULL, 0, false);
-    main_func = LLVMAddFunction(llvm_module, "main", main_func_type);
-    LLVMSetLinkage(main_func, LLVMExternalLinkage);
+    parser->compiler->main_func = codegen_main_function(parser->compiler);
 
-    Symbol* s = init_symbol_with_id_symbol_type("main", T_ID, ST_PROCEDURE, TC_VOID);
-    s->llvm_function = main_func;
+    Symbol* s = init_symbol_with_id_symbol_type(parser->compiler, "main", T_ID, ST_PROCEDURE, TC_VOID);
+    s->llvm_function = parser->compiler->main_func;
     set_current_procedure(parser->sem, *s);
 
     if (!program_body(parser))
@@ -250,7 +255,7 @@ bool program(parser_T* parser)
     // in this case.
     if (!parser_eat(parser, T_EOF))
     {
-        throw_error("Missing period at the end of program.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing period at the end of program.\n", parser->look_ahead);
         return false;
     }
 
@@ -272,7 +277,7 @@ bool program_header(parser_T* parser)
 {
     parser_eat(parser, K_PROGRAM);
 
-    Symbol *id = init_symbol();
+    Symbol *id = init_symbol(parser->compiler);
 
     if (!identifier(parser, id))
     {
@@ -280,21 +285,13 @@ bool program_header(parser_T* parser)
     }
 
     // Create LLVM module with program identifier
-    llvm_module = LLVMModuleCreateWithNameInContext(id->id, llvm_context);
-    
-    // Create runtime module and link it with main module
-    LLVMMemoryBufferRef buffer = NULL;
-    char* err = NULL;
-    LLVMCreateMemoryBufferWithContentsOfFile("src/runtime.ll", &buffer, &err);
-    LLVMParseIRInContext(llvm_context, buffer, &llvm_module, NULL);
-    LLVMSetModuleIdentifier(llvm_module, id->id, strlen(id->id));
+    codegen_module(parser->compiler, id->id);
 
     // After module created, add runtime functions
     insert_runtime_functions(parser->sem);
 
     parser_eat(parser, K_IS);
 
-    free(id);
 
     return true;
 }
@@ -307,6 +304,9 @@ bool program_header(parser_T* parser)
  */
 bool program_body(parser_T* parser)
 {
+    AstMark mark = ast_mark(parser->ast);
+    NodeIndex body = NO_NODE;
+
     if (!declaration_list(parser))
     {
         return false;
@@ -314,35 +314,34 @@ bool program_body(parser_T* parser)
 
     if (!parser_eat(parser, K_BEGIN))
     {
-        throw_error("Missing \'begin\' keyword in the program.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \'begin\' keyword in the program.\n", parser->look_ahead);
         return false;
     }
 
-    LLVMValueRef func = get_current_procedure(parser->sem).llvm_function;
-
-    // Set main entrypoint
-    LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(llvm_context, func, "entry");
-    LLVMPositionBuilderAtEnd(llvm_builder, entry);
-
-    if (!statement_list(parser))
+    if (!statement_list(parser, &body))
     {
         return false;
     }
 
     if (!parser_eat(parser, K_END))
     {
-        throw_error("Missing \'end\' keyword in program body.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \'end\' keyword in program body.\n", parser->look_ahead);
         return false;
     }
 
     if (!parser_eat(parser, K_PROGRAM))
     {
-        throw_error("Missing \'program\' keyword in program body.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \'program\' keyword in program body.\n", parser->look_ahead);
         return false;
     }
 
-    // End main function, return 0
-    LLVMBuildRetVoid(llvm_builder);
+    codegen_program_body(parser->codegen, get_current_procedure(parser->sem), body);
+
+    // The procedures kept for -j are still in the tree
+    if (parser->jobs <= 1 && !parser->split_units)
+    {
+        ast_release(parser->ast, mark);
+    }
 
     return true;
 }
@@ -354,7 +353,7 @@ bool program_body(parser_T* parser)
  */
 bool declaration(parser_T* parser)
 {   
-    Symbol *decl = init_symbol();
+    Symbol *decl = init_symbol(parser->compiler);
 
     if (is_token_type(parser, K_GLOBAL))
     {
@@ -378,8 +377,6 @@ bool declaration(parser_T* parser)
             state = false;
     }
 
-    free(decl);
-
     return state;
 }
 
@@ -396,56 +393,17 @@ bool procedure_declaration(parser_T* parser, Symbol* decl)
     decl->stype = ST_PROCEDURE;
 
     // Check for duplicate identifier in current scope and global
-    if (has_current_global_symbol(parser->sem, decl->id, decl->is_global))
+    if (has_current_global_symbol(parser->sem, decl->name, decl->is_global))
     {
-        throw_error(concatf("Procedure name %s is already used in current scope.\n", decl->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Procedure name %s is already used in current scope.\n", decl->id), parser->look_ahead);
         return false;
     }
 
-    // Function codegen, parsing parameters first
-    int param_cnt = params_size(decl);
-    int counter = 0;
-    LLVMTypeRef* param_types = (LLVMTypeRef *) malloc(sizeof(LLVMTypeRef) * param_cnt);
-    
-    SymbolNode *tmp;
-    LLVMTypeRef ty;
-    tmp = decl->params;
-    while (tmp != NULL)
-    {
-        ty = create_llvm_type(tmp->symbol.type);
-        if (tmp->symbol.is_arr)
-        {
-            param_types[counter++] = LLVMArrayType(ty, params_size(&tmp->symbol));
-        }
-        else
-        {
-            param_types[counter++] = create_llvm_type(tmp->symbol.type);
-        }
-        tmp = tmp->next_symbol;
-    }
-
-
-    LLVMTypeRef ft = LLVMFunctionType(create_llvm_type(decl->type), param_types, param_cnt, false);
-    LLVMValueRef func = LLVMAddFunction(llvm_module, decl->id, ft);
-    LLVMSetLinkage(func, LLVMExternalLinkage);
-
-    // Set parameter names
-    tmp = decl->params;
-    counter = 0;
-
-    while (tmp != NULL && counter < param_cnt)
-    {
-        Symbol current_args = tmp->symbol;
-        LLVMValueRef param = LLVMGetParam(func, counter);
-        LLVMSetValueName2(param, current_args.id, strlen(current_args.id));
-        counter++;
-        tmp = tmp->next_symbol;
-    }
-
-    decl->llvm_function = func;
+    // Function codegen, the body is emitted once parsed
+    codegen_procedure_declaration(parser->compiler, decl);
 
     // Set symbol in current scope
-    set_symbol_semantic(parser->sem, decl->id, *decl, decl->is_global);
+    set_symbol_semantic(parser->sem, decl->name, *decl, decl->is_global);
 
     // Set to procedure scope for type checking return type
     set_current_procedure(parser->sem, *decl);
@@ -462,14 +420,14 @@ bool procedure_declaration(parser_T* parser, Symbol* decl)
     if (!decl->is_global)
     {
         // Error for duplicate name in local scope outside the function
-        if (has_current_global_symbol(parser->sem, decl->id, decl->is_global))
+        if (has_current_global_symbol(parser->sem, decl->name, decl->is_global))
         {
-            throw_error(concatf("Procedure name \'%s\' is already used in this scope.\n", decl->id), parser->look_ahead);
+            throw_error(parser->compiler, concatf("Procedure name \'%s\' is already used in this scope.\n", decl->id), parser->look_ahead);
             return false;
         }
 
         // Set in local scope outside the function
-        set_symbol_semantic(parser->sem, decl->id, *decl, decl->is_global);
+        set_symbol_semantic(parser->sem, decl->name, *decl, decl->is_global);
     }
 
     return true;
@@ -490,39 +448,39 @@ bool procedure_header(parser_T* parser, Symbol* decl)
 
     if (!identifier(parser, decl))
     {
-        throw_error(concatf("Invalid identifier \'%s\'\n", decl->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Invalid identifier \'%s\'\n", decl->id), parser->look_ahead);
         return false;
     }
 
     if (!parser_eat(parser, T_COLON))
     {
-        throw_error(concatf("Missing \':\' in procedure header.\n"), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Missing \':\' in procedure header.\n"), parser->look_ahead);
         return false;
     }
 
     if (!type_mark(parser, decl))
     {
-        throw_error(concatf("Invalid type mark\n"), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Invalid type mark\n"), parser->look_ahead);
         return false;
     }
 
     if (!parser_eat(parser, T_LPAREN))
     {
-        throw_error(concatf("Missing \'(\' in procedure header.\n"), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Missing \'(\' in procedure header.\n"), parser->look_ahead);
         return false;
     }
 
     // Optional parameter list
     parameter_list(parser, decl);
 
-    if (error_flag)
+    if (parser->compiler->error_flag)
     {
         return false;
     }
 
     if (!parser_eat(parser, T_RPAREN))
     {
-        throw_error("Missing \')\' in procedure header.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \')\' in procedure header.\n", parser->look_ahead);
         return false;
     }
     return true;
@@ -535,68 +493,26 @@ bool procedure_header(parser_T* parser, Symbol* decl)
  */
 bool parameter_list(parser_T* parser, Symbol* decl)
 {   
-    Symbol param = *init_symbol();
+    Symbol param = *init_symbol(parser->compiler);
     if (!parameter(parser, &param))
     {
         return false;
     }
 
-    if (decl->params->symbol.is_not_empty == false)
-    {
-        decl->params->symbol = param;
-        decl->params->next_symbol = NULL;
-    }
-    else
-    {
-        SymbolNode *ptr, *new_node;
-        new_node = calloc(1, sizeof(SymbolNode));
-
-        new_node->symbol = param;
-        new_node->next_symbol = NULL;
-
-        ptr = decl->params;
-
-        while (ptr != NULL && ptr->next_symbol != NULL)
-        {
-            ptr = ptr->next_symbol;
-        }
-
-        ptr->next_symbol = new_node;
-    }
+    add_param(parser->compiler, decl, param);
 
     // Optional parameters
     while (is_token_type(parser, T_COMMA))
     {
         parser_eat(parser, T_COMMA);
-        param = *init_symbol();
+        param = *init_symbol(parser->compiler);
         if (!parameter(parser, &param))
         {
-            throw_error("Invalid parameter.\n", parser->look_ahead);
+            throw_error(parser->compiler, "Invalid parameter.\n", parser->look_ahead);
             return false;
         }
 
-        if (decl->params->symbol.is_not_empty == false)
-        {
-            decl->params->symbol = param;
-            decl->params->next_symbol = NULL;
-        }
-        else
-        {
-            SymbolNode *ptr, *new_node;
-            new_node = calloc(1, sizeof(SymbolNode));
-
-            new_node->symbol = param;
-            new_node->next_symbol = NULL;
-
-            ptr = decl->params;
-
-            while (ptr != NULL && ptr->next_symbol != NULL)
-            {
-                ptr = ptr->next_symbol;
-            }
-
-            ptr->next_symbol = new_node;
-        }
+        add_param(parser->compiler, decl, param);
     }
     return true;
 }
@@ -618,6 +534,9 @@ bool parameter(parser_T* parser, Symbol* param)
  */
 bool procedure_body(parser_T* parser)
 {
+    AstMark mark = ast_mark(parser->ast);
+    NodeIndex body = NO_NODE;
+
     if (!declaration_list(parser))
     {
         return false;
@@ -627,114 +546,44 @@ bool procedure_body(parser_T* parser)
     {
         return false;
     }
+    NodeIndex first = parser->ast->count;
 
-    Symbol current_proc = get_current_procedure(parser->sem);
-    LLVMValueRef func = current_proc.llvm_function;
-
-    // Set entrypoint for function
-    LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(llvm_context, func, "entry");
-    LLVMPositionBuilderAtEnd(llvm_builder, entry);
-
-    // Allocate address for parameters and variable in current symbol table
-    SymbolTable* current_symbol;
-
-    unsigned int num_symbols = symbol_table_size(parser->sem->current_local->table);
-    int counter = 0;
-
-    for (current_symbol = parser->sem->current_local->table; current_symbol != NULL; current_symbol = current_symbol->hh.next)
-    {
-        if (counter == num_symbols)
-        {
-            break;
-        }
-
-        Symbol current_entry = current_symbol->entry;
-        if (current_entry.stype != ST_VARIABLE)
-        {
-            continue;
-        }
-
-        LLVMTypeRef ty = NULL;
-        LLVMValueRef addr = NULL;
-        if (current_entry.is_arr)
-        {
-            ty = LLVMArrayType(create_llvm_type(current_entry.type), current_entry.arr_size);
-            addr = LLVMBuildArrayAlloca(llvm_builder, ty, NULL, current_entry.id);
-        }
-        else
-        {
-            ty = create_llvm_type(current_entry.type);
-            addr = LLVMBuildAlloca(llvm_builder, ty, current_entry.id);
-        }
-
-        current_entry.llvm_address = addr;
-        update_symbol_semantic_global(parser->sem, current_entry, current_entry.is_global);
-        counter += 1;
-    }
-
-    
-    // Store argument values in allocated addresses
-    SymbolNode *tmp;
-    counter = 0;
-    int param_cnt = params_size(&current_proc);
-    LLVMValueRef current_param = NULL;
-    tmp = current_proc.params;
-
-    while (tmp != NULL && counter < param_cnt)
-    {
-        current_param = LLVMGetParam(func, counter);
-        // Get current symbol from local table since
-        // parameter linked list is not up to date with symbol table
-        Symbol param = get_current_global_symbol(parser->sem, tmp->symbol.id, tmp->symbol.is_global);
-
-        // Store parameter value in address
-        if (param.is_arr)
-        {
-            // Create a dummy symbol to pass
-            // Type must be same as param,
-            // otherwise it would've failed in type_checking
-            Symbol tmp_param_val = *init_symbol_with_id_symbol_type("", T_ID, ST_VARIABLE, param.type);
-            tmp_param_val.llvm_address = current_param;
-            // current_param is an llvm_address to the array;
-
-            // Loop through each index and copy values from
-            // argument to parameter (local) array
-            array_assignment_codegen(parser, &param, &tmp_param_val);
-        }
-        else
-        {
-            // current_param is a normal llvm_value
-            LLVMBuildStore(llvm_builder, current_param, param.llvm_address);
-
-            // Update symbol
-            param.llvm_value = current_param;
-            update_symbol_semantic_global(parser->sem, param, param.is_global);
-        }
-        tmp = tmp->next_symbol;
-    }
-
-    if (!statement_list(parser))
+    if (!statement_list(parser, &body))
     {
         return false;
     }
 
     if (!parser_eat(parser, K_END))
     {
-        throw_error("Missing \'end\' keyword in procedure body\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \'end\' keyword in procedure body\n", parser->look_ahead);
         return false;
     }
 
     if (!parser_eat(parser, K_PROCEDURE))
     {
-        throw_error("Missing \'procedure\' keyword at the end of procedure.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \'procedure\' keyword at the end of procedure.\n", parser->look_ahead);
         return false;
     }
 
-    // Verify that function has a return value
-    LLVMBool invalid = LLVMVerifyFunction(func, LLVMReturnStatusAction);
-    if (invalid)
+    // Capture the body while its scope is current. With -j it is kept
+    // and emitted once parsing is done, otherwise it is emitted now,
+    // verifying that the function has a return value
+    codegen_T* cg = parser->codegen;
+    ProcedureUnit* unit = capture_procedure_unit(cg, get_current_procedure(parser->sem), first, body);
+    if ((parser->jobs > 1 || parser->split_units) && !unit->serial)
+    {
+        return true;
+    }
+
+    bool valid = codegen_procedure_unit(cg, unit);
+    drop_procedure_unit(cg);
+    if (parser->jobs <= 1 && !parser->split_units)
     {
-        throw_error("Function does not have a return value.\n", parser->look_ahead);
+        ast_release(parser->ast, mark);
+    }
+    if (!valid)
+    {
+        throw_error(parser->compiler, "Function does not have a return value.\n", parser->look_ahead);
         return false;
     }
 
@@ -756,26 +605,26 @@ bool variable_declaration(parser_T* parser, Symbol* decl)
 
     if (!identifier(parser, decl))
     {
-        throw_error(concatf("Invalid identifier \'%s\'\n", decl->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Invalid identifier \'%s\'\n", decl->id), parser->look_ahead);
         return false;
     }
 
     // Check for duplicate identifier name in current scope
-    if (has_current_global_symbol(parser->sem, decl->id, decl->is_global))
+    if (has_current_global_symbol(parser->sem, decl->name, decl->is_global))
     {
-        throw_error(concatf("Variable name \'%s\' is already in used in current scope.\n", decl->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Variable name \'%s\' is already in used in current scope.\n", decl->id), parser->look_ahead);
         return false;
     }
 
     if (!parser_eat(parser, T_COLON))
     {
-        throw_error(concatf("Missing \':\' in variable declaration.\n"), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Missing \':\' in variable declaration.\n"), parser->look_ahead);
         return false;
     }
 
     if (!type_mark(parser, decl))
     {
-        throw_error("Invalid type mark.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Invalid type mark.\n", parser->look_ahead);
         return false;
     }
 
@@ -785,7 +634,7 @@ bool variable_declaration(parser_T* parser, Symbol* decl)
         parser_eat(parser, T_LBRACKET);
         if (!bound(parser, decl))
         {
-            throw_error("Invalid bound.\n", parser->look_ahead);
+            throw_error(parser->compiler, "Invalid bound.\n", parser->look_ahead);
             return false;
         }
 
@@ -793,28 +642,18 @@ bool variable_declaration(parser_T* parser, Symbol* decl)
 
         if (!parser_eat(parser, T_RBRACKET))
         {
-            throw_error("Missing \']\' in variable bound.\n", parser->look_ahead);
+            throw_error(parser->compiler, "Missing \']\' in variable bound.\n", parser->look_ahead);
         }
     }
 
     // Global variable allocation
     if (decl->is_global)
     {
-        LLVMTypeRef ty = create_llvm_type(decl->type);
-        if (decl->is_arr)
-        {
-            ty = LLVMArrayType(ty, decl->arr_size);
-        }
-
-        // Default value
-        LLVMValueRef init_val = LLVMConstNull(ty);
-        LLVMValueRef address = LLVMAddGlobal(llvm_module, ty, decl->id);
-        LLVMSetInitializer(address, init_val);
-        decl->llvm_address = address;
+        codegen_global_variable(parser->compiler, decl);
     }
 
     // Set symbol to current scope
-    set_symbol_semantic(parser->sem, decl->id, *decl, decl->is_global);
+    set_symbol_semantic(parser->sem, decl->name, *decl, decl->is_global);
 
     return true;
 }
@@ -853,17 +692,17 @@ bool type_mark(parser_T* parser, Symbol* id)
  */
 bool bound(parser_T* parser, Symbol* id)
 {
-    Symbol* num = init_symbol();
+    Value num = init_value();
     int tmp = parser->look_ahead->value.intVal;
 
-    if (number(parser, num) && num->type == TC_INT && tmp > 0)
+    if (number(parser, &num) && num.type == TC_INT && tmp > 0)
     {
         id->arr_size = tmp;
         return true;
     }
     else
     {   
-        throw_error("Invalid bound value. Must be a positive integer.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Invalid bound value. Must be a positive integer.\n", parser->look_ahead);
         return false;
     }
 }
@@ -874,40 +713,107 @@ bool bound(parser_T* parser, Symbol* id)
  *    | <if_statement>
  *    | <loop_statement>
  *    | <return_statement>
+ *
+ * Tries the alternatives from first on. An if or loop statement only
+ * parses up to its statement list here, and is left open on the block
+ * stack for statement_list to finish.
  */
-bool statement(parser_T* parser)
+StatementState statement(parser_T* parser, StatementKind first, NodeIndex* stmt)
 {
-    // bool state;
-    if (assignment_statement(parser))
+    Block block;
+    block.in_else = false;
+    block.list.head = NO_NODE;
+    block.list.tail = NO_NODE;
+
+    if (first <= STMT_ASSIGNMENT && assignment_statement(parser, stmt))
+    {
+        return STATEMENT_DONE;
+    }
+    if (first <= STMT_IF && if_statement(parser, &block))
     {
+        block.kind = STMT_IF;
+        push_block(parser, block);
+        return STATEMENT_OPENED;
+    }
+    if (first <= STMT_LOOP && loop_statement(parser, &block))
+    {
+        block.kind = STMT_LOOP;
+        push_block(parser, block);
+        return STATEMENT_OPENED;
+    }
+    if (return_statement(parser, stmt))
+    {
+        return STATEMENT_DONE;
+    }
+    return STATEMENT_FAILED;
+}
+
+/*
+ * The statement list of the innermost open block has ended with state.
+ * Finish its block statement, which either opens the else list
+ * or is done and becomes a statement of the list around it.
+ */
+StatementState end_block(parser_T* parser, bool state, NodeIndex* stmt)
+{
+    Block* block = &parser->blocks[parser->block_count - 1];
+    StatementKind kind = block->kind;
 
+    StatementState result = STATEMENT_FAILED;
+    if (state)
+    {
+        result = kind == STMT_IF ? if_statement_end(parser, block) : loop_statement_end(parser, block);
     }
-    else if (if_statement(parser))
+
+    if (result == STATEMENT_OPENED)
     {
+        return result;
+    }
+    *stmt = block->node;
+    parser->block_count--;
 
+    // A failed alternative of <statement> still lets the ones after it try
+    if (result == STATEMENT_FAILED)
+    {
+        result = statement(parser, kind + 1, stmt);
     }
-    else if (loop_statement(parser))
+    return result;
+}
+
+void push_block(parser_T* parser, Block block)
+{
+    if (parser->block_count == parser->block_capacity)
     {
-        
+        parser->block_capacity = parser->block_capacity == 0 ? PARSE_STACK_INITIAL_CAPACITY : parser->block_capacity * 2;
+        parser->blocks = realloc(parser->blocks, parser->block_capacity * sizeof(Block));
     }
-    else if (return_statement(parser))
+    parser->blocks[parser->block_count++] = block;
+}
+
+/*
+ * Add a finished statement to the innermost open list,
+ * root is the list of statement_list itself
+ */
+void append_statement(parser_T* parser, unsigned int base, StatementList* root, NodeIndex stmt)
+{
+    StatementList* list = parser->block_count > base ? &parser->blocks[parser->block_count - 1].list : root;
+    if (list->tail == NO_NODE)
     {
-        
+        list->head = stmt;
     }
     else
     {
-        return false;
+        parser->ast->nodes[list->tail].next = stmt;
     }
-    return true;
+    list->tail = stmt;
 }
 
 /*
  * <assignment_statement> ::= <destination> := <expression>
  */
-bool assignment_statement(parser_T* parser)
+bool assignment_statement(parser_T* parser, NodeIndex* stmt)
 {
-    Symbol dest = *init_symbol();
-    Symbol exp = *init_symbol();
+    Value dest = init_value();
+    Value exp = init_value();
 
     if (!destination(parser, &dest))
     {
@@ -925,76 +831,62 @@ bool assignment_statement(parser_T* parser)
     }
 
     // Type checking
-    if (!type_checking(parser, &dest, &exp))
+    Conversion conv = CONV_NONE;
+    if (!type_checking(parser, &dest, &exp, &conv))
     {
         return false;
     }
 
-    // Assignment codegen
-    if (dest.is_arr && !dest.is_indexed)
-    {
-        // Bot dest and exp are unindexed arrays;
-        // Copy element by element
-        array_assignment_codegen(parser, &dest, &exp);
-    }
-    else
-    {
-        LLVMBuildStore(llvm_builder, exp.llvm_value, dest.llvm_address);
-    }
-
-    // Update symbol
-    if (!dest.is_arr)
-    {
-        dest.llvm_value = exp.llvm_value;
-        update_symbol_semantic_global(parser->sem, dest, dest.is_global);
-    }
+    *stmt = ast_add(parser->ast, NODE_ASSIGN);
+    Node* node = &parser->ast->nodes[*stmt];
+    node->lhs = dest.node;
+    node->rhs = exp.node;
+    node->rhs_conv = conv;
+    node->type = dest.type;
+    node->arr_size = dest.arr_size;
 
+    // Both dest and exp are unindexed arrays,
+    // they are copied element by element
+    node->is_arr = dest.is_arr && !dest.is_indexed;
     return true;
 }
 
 /*
  * <destination> ::= <identifier> [ [ <expression> ] ]
  */
-bool destination(parser_T* parser, Symbol* id)
+bool destination(parser_T* parser, Value* dest)
 {
-    if (!identifier(parser, id))
+    const InternedString* id_name = is_token_type(parser, T_ID) ? parser->look_ahead->value.idVal : NULL;
+    if (!parser_eat(parser, T_ID))
     {
         return false;
     }
 
-    // Check if identifier is in local or global scope
-    if (!has_current_symbol(parser->sem, id->id))
+    // Get id from local or global scope
+    Symbol* id = get_current_symbol(parser->sem, id_name);
+    if (id == NULL)
     {
-        throw_error(concatf("\'%s\' is not declared in scope.\n", id->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("\'%s\' is not declared in scope.\n", id_name->str), parser->look_ahead);
         return false;
     }
 
-    // Get id from local or global scope
-    *id = get_current_global_symbol(parser->sem, id->id, id->is_global);
-
     // Confirm that it's a name
     if (id->stype != ST_VARIABLE)
     {
-        throw_error(concatf("%s is not a valid destination\n", id->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("%s is not a valid destination\n", id->id), parser->look_ahead);
         return false;
     }
 
-    Symbol ind = *init_symbol();
-    if (!array_index(parser, id, &ind))
+    *dest = init_value_from_symbol(id);
+
+    Value ind = init_value();
+    if (!array_index(parser, id, dest, &ind))
     {
         return false;
     }
 
-
-    // Codegen: Get array destination address
-    if (id->is_indexed)
-    {
-        LLVMValueRef zero_val = LLVMConstInt(int32_type, 0, true);
-
-        // Get pointer to the element of the array
-        LLVMValueRef indices[] = { zero_val, ind.llvm_value };
-        id->llvm_address = LLVMBuildInBoundsGEP(llvm_builder, id->llvm_address, indices, 2, "");
-    }
+    // Destination node computes the address to store to
+    name_node(parser, NODE_DESTINATION, id, dest, &ind);
     return true;
 }
 
@@ -1003,8 +895,10 @@ bool destination(parser_T* parser, Symbol* id)
  *      if ( <expression> ) then ( <statement> ; )*
  *      [ else ( <statement> ; )* ]
  *      end if
+ *
+ * Parses up to the statement list, if_statement_end does the rest
  */
-bool if_statement(parser_T* parser)
+bool if_statement(parser_T* parser, Block* block)
 {
     if (!parser_eat(parser, K_IF))
     {
@@ -1013,11 +907,11 @@ bool if_statement(parser_T* parser)
 
     if (!parser_eat(parser, T_LPAREN))
     {
-        throw_error("Missing \'(\' in if statement\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \'(\' in if statement\n", parser->look_ahead);
         return false;
     }
 
-    Symbol exp = *init_symbol();
+    Value exp = init_value();
 
     if (!expression(parser, &exp))
     {
@@ -1026,86 +920,73 @@ bool if_statement(parser_T* parser)
 
     if (!parser_eat(parser, T_RPAREN))
     {
-        throw_error("Missing \')\' in if statement\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \')\' in if statement\n", parser->look_ahead);
         return false;
     }
 
     // Type check/convert to bool
+    Conversion conv = CONV_NONE;
     if (exp.type == TC_INT)
     {
         exp.type = TC_BOOL;
-
-        LLVMValueRef zero_val = LLVMConstInt(int32_type, 0, true);
-        exp.llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntNE, exp.llvm_value, zero_val, "");
+        conv = CONV_INT_TO_BOOL;
     }
     else if (exp.type != TC_BOOL)
     {
-        throw_error("If statement expression must evaluate to bool.\n", parser->look_ahead);
+        throw_error(parser->compiler, "If statement expression must evaluate to bool.\n", parser->look_ahead);
         return false;
     }
 
-    // Codegen If statement
-    LLVMValueRef func = get_current_procedure(parser->sem).llvm_function;
-    LLVMValueRef zero_val = LLVMConstInt(int1_type, 0, true);
-    LLVMValueRef if_cond = LLVMBuildICmp(llvm_builder, LLVMIntNE, exp.llvm_value, zero_val, "");
-    exp.llvm_value = if_cond;
-
-    LLVMBasicBlockRef if_then_block = LLVMAppendBasicBlockInContext(llvm_context, func, "ifThen");
-    LLVMBasicBlockRef else_block = LLVMAppendBasicBlockInContext(llvm_context, func, "ifElse");
-    LLVMBasicBlockRef merge_block = LLVMAppendBasicBlockInContext(llvm_context, func, "ifMerge");
-
-    LLVMBuildCondBr(llvm_builder, if_cond, if_then_block, else_block);
-    LLVMPositionBuilderAtEnd(llvm_builder, if_then_block);
+    block->node = ast_add(parser->ast, NODE_IF);
+    parser->ast->nodes[block->node].lhs = exp.node;
+    parser->ast->nodes[block->node].lhs_conv = conv;
 
     if (!parser_eat(parser, K_THEN))
     {
-        throw_error("Missing \'then\' in if statement\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \'then\' in if statement\n", parser->look_ahead);
         return false;
     }
+    return true;
+}
 
-    if (!statement_list(parser))
-    {
-        return false;
-    }
+/*
+ * Rest of the if statement after the then or else statement list
+ */
+StatementState if_statement_end(parser_T* parser, Block* block)
+{
+    Node* node = &parser->ast->nodes[block->node];
 
-    // Merge if_then_block into merge_block if there wasn't a return
-    if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(llvm_builder)) == NULL)
+    if (block->in_else)
     {
-        LLVMBuildBr(llvm_builder, merge_block);
+        node->extra = block->list.head;
     }
-
-    LLVMPositionBuilderAtEnd(llvm_builder, else_block);
-
-    // Optional else statement
-    if (is_token_type(parser, K_ELSE))
+    else
     {
-        parser_eat(parser, K_ELSE);
-        if (!statement_list(parser))
+        node->rhs = block->list.head;
+
+        // Optional else statement
+        if (is_token_type(parser, K_ELSE))
         {
-            return false;
+            parser_eat(parser, K_ELSE);
+            block->in_else = true;
+            block->list.head = NO_NODE;
+            block->list.tail = NO_NODE;
+            return STATEMENT_OPENED;
         }
     }
 
-    // Merge else block into merge block if there wasn't a return
-    if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(llvm_builder)) == NULL)
-    {
-        LLVMBuildBr(llvm_builder, merge_block);
-    }
-
-    LLVMPositionBuilderAtEnd(llvm_builder, merge_block);
-
     if (!parser_eat(parser, K_END))
     {
-        throw_error("Missing \'end\' in if statement\n", parser->look_ahead);
-        return false;
+        throw_error(parser->compiler, "Missing \'end\' in if statement\n", parser->look_ahead);
+        return STATEMENT_FAILED;
     }
 
     if (!parser_eat(parser, K_IF))
     {
-        throw_error("Missing closing \'if\'\n", parser->look_ahead);
-        return false;
+        throw_error(parser->compiler, "Missing closing \'if\'\n", parser->look_ahead);
+        return STATEMENT_FAILED;
     }
-    return true;
+    return STATEMENT_DONE;
 }
 
 /*
@@ -1113,8 +994,10 @@ bool if_statement(parser_T* parser)
  *      for ( <assignment_statement> ; <expression> )
  *          ( <statement> ; )*
  *      end for
+ *
+ * Parses up to the statement list, loop_statement_end does the rest
  */
-bool loop_statement(parser_T* parser)
+bool loop_statement(parser_T* parser, Block* block)
 {
     if (!parser_eat(parser, K_FOR))
     {
@@ -1123,112 +1006,89 @@ bool loop_statement(parser_T* parser)
 
     if (!parser_eat(parser, T_LPAREN))
     {
-        throw_error("Missing \'(\' in loop\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \'(\' in loop\n", parser->look_ahead);
         return false;
     }
 
-    if (!assignment_statement(parser))
+    NodeIndex init = NO_NODE;
+    if (!assignment_statement(parser, &init))
     {
         return false;
     }
 
     if (!parser_eat(parser, T_SEMI_COLON))
     {
-        throw_error("Missing \':\' in loop\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \':\' in loop\n", parser->look_ahead);
         return false;
     }
 
-    // Codegen: loop
-    LLVMValueRef func = get_current_procedure(parser->sem).llvm_function;
-
-    LLVMBasicBlockRef loop_header_block = LLVMAppendBasicBlockInContext(llvm_context, func, "loop_head");
-    LLVMBasicBlockRef loop_body_block = LLVMAppendBasicBlockInContext(llvm_context, func, "loop_body");
-    LLVMBasicBlockRef loop_merge_block = LLVMAppendBasicBlockInContext(llvm_context, func, "loop_merge");
-
-    LLVMBuildBr(llvm_builder, loop_header_block);
-    LLVMPositionBuilderAtEnd(llvm_builder, loop_header_block);
-
-    Symbol exp = *init_symbol();
+    Value exp = init_value();
 
     if (!expression(parser, &exp))
     {
         return false;
     }
 
-    exp = get_current_global_symbol(parser->sem, exp.id, exp.is_global);
-
     if (!parser_eat(parser, T_RPAREN))
     {
-        throw_error("Missing \')\' in loop\n", parser->look_ahead);
+        throw_error(parser->compiler, "Missing \')\' in loop\n", parser->look_ahead);
         return false;
     }
 
     // Type checking for boolean value
+    Conversion conv = CONV_NONE;
     if (exp.type == TC_INT)
     {
         exp.type = TC_BOOL;
-
-        LLVMValueRef zero_val = LLVMConstInt(int32_type, 0, true);
-        exp.llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntNE, exp.llvm_value, zero_val, "");
+        conv = CONV_INT_TO_BOOL;
     }
     else if (exp.type != TC_BOOL)
     {
-        throw_error("Loop statement expressions must evalutate to boolean value.\n", parser->look_ahead);
-        return false;
-    }
-
-    // Codegen: Loop condition
-    LLVMValueRef zero_val = LLVMConstInt(int1_type, 0, true);
-    LLVMValueRef loop_cond = LLVMBuildICmp(llvm_builder, LLVMIntNE, exp.llvm_value, zero_val, "");
-    exp.llvm_value = loop_cond;
-
-    LLVMBuildCondBr(llvm_builder, loop_cond, loop_body_block, loop_merge_block);
-
-    // Loop body
-    LLVMPositionBuilderAtEnd(llvm_builder, loop_body_block);
-
-    if (!statement_list(parser))
-    {
+        throw_error(parser->compiler, "Loop statement expressions must evalutate to boolean value.\n", parser->look_ahead);
         return false;
     }
 
-    // Go back to the header to check the condition
-    // Merge else block into merge if there wasn't a return
-
-    if (LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(llvm_builder)) == NULL)
-    {
-        LLVMBuildBr(llvm_builder, loop_header_block);
-    }
-
-    LLVMPositionBuilderAtEnd(llvm_builder, loop_merge_block);
+    block->node = ast_add(parser->ast, NODE_LOOP);
+    Node* node = &parser->ast->nodes[block->node];
+    node->lhs = init;
+    node->rhs = exp.node;
+    node->rhs_conv = conv;
+    return true;
+}
 
+/*
+ * Rest of the loop statement after its body
+ */
+StatementState loop_statement_end(parser_T* parser, Block* block)
+{
+    parser->ast->nodes[block->node].extra = block->list.head;
 
     if (!parser_eat(parser, K_END))
     {
-        throw_error("Missing \'end\' in loop\n", parser->look_ahead);
-        return false;
+        throw_error(parser->compiler, "Missing \'end\' in loop\n", parser->look_ahead);
+        return STATEMENT_FAILED;
     }
 
     if (!parser_eat(parser, K_FOR))
     {
-        throw_error("Missing closing \'for\' in loop\n", parser->look_ahead);
-        return false;
+        throw_error(parser->compiler, "Missing closing \'for\' in loop\n", parser->look_ahead);
+        return STATEMENT_FAILED;
     }
 
-    return true;
+    return STATEMENT_DONE;
 }
 
 /*
  * <return_statement> ::= return <expression>
  */
-bool return_statement(parser_T* parser)
+bool return_statement(parser_T* parser, NodeIndex* stmt)
 {
     if (!parser_eat(parser, K_RETURN))
     {
         return false;
     }
 
-    Symbol exp = *init_symbol();
+    Value exp = init_value();
 
     if (!expression(parser, &exp))
     {
@@ -1236,19 +1096,23 @@ bool return_statement(parser_T* parser)
     }
 
     // Type checking to match procedure return type
-    Symbol proc = get_current_procedure(parser->sem);
-    if (proc.type == TC_UNKNOWN)
+    Symbol* proc = get_current_procedure(parser->sem);
+    if (proc == NULL || proc->type == TC_UNKNOWN)
     {
-        throw_error("Return statements must be within a procedure.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Return statements must be within a procedure.\n", parser->look_ahead);
         return false;
     }
-    else if (!type_checking(parser, &proc, &exp))
+
+    Value ret = init_value_from_symbol(proc);
+    Conversion conv = CONV_NONE;
+    if (!type_checking(parser, &ret, &exp, &conv))
     {
         return false;
     }
 
-    // Code gen: Return statement
-    LLVMBuildRet(llvm_builder, exp.llvm_value);
+    *stmt = ast_add(parser->ast, NODE_RETURN);
+    parser->ast->nodes[*stmt].lhs = exp.node;
+    parser->ast->nodes[*stmt].lhs_conv = conv;
     return true;
 }
 
@@ -1259,7 +1123,8 @@ bool identifier(parser_T* parser, Symbol* id)
 {
     if (is_token_type(parser, T_ID))
     {
-        id->id = parser->look_ahead->value.stringVal;
+        id->name = parser->look_ahead->value.idVal;
+        id->id = (char*) id->name->str;
         id->ttype = parser->look_ahead->type;
     }
     return parser_eat(parser, T_ID);
@@ -1267,289 +1132,243 @@ bool identifier(parser_T* parser, Symbol* id)
 
 /*
  * <expression> ::= [ not ] <arith_op> <expression_prime>
+ *
+ * Parenthesized groups and pending operators are kept on parser->groups
+ * and parser->ops instead of the C stack, so neither nesting depth nor
+ * the length of an operator chain is limited by it. Array indexes and
+ * arguments parse their expressions above the entries of this one.
  */
-bool expression(parser_T* parser, Symbol* exp)
-{   
-    // Optional NOT
-    bool not_flag = false;
-    if (is_token_type(parser, K_NOT))
-    {
-        not_flag = true;
-        parser_eat(parser, K_NOT);
-    }
+bool expression(parser_T* parser, Value* exp)
+{
+    unsigned int group_base = parser->group_count;
+    unsigned int op_base = parser->op_count;
+    bool group_start = true;
+    bool state = true;
 
-    if (!arith_op(parser, exp))
+    push_group(parser);
+    while (state)
     {
-        return false;
-    }
-
-    // Type checking for not operator
-    // Valid:
-    // bool
-    // int
+        // Optional NOT, only at the start of a group
+        if (group_start && is_token_type(parser, K_NOT))
+        {
+            parser_eat(parser, K_NOT);
+            parser->groups[parser->group_count - 1].not_flag = true;
+        }
 
-    if (not_flag)
-    {
-        if (exp->type == TC_BOOL || exp->type == TC_INT)
+        // <factor> ::= ( <expression> )
+        if (is_token_type(parser, T_LPAREN))
         {
-            exp->llvm_value = LLVMBuildNot(llvm_builder, exp->llvm_value, "");
+            parser_eat(parser, T_LPAREN);
+            push_group(parser);
+            group_start = true;
+            continue;
         }
-        else
+
+        Value operand = init_value();
+        if (!factor(parser, &operand))
         {
-            throw_error("!= operator is defined for bool and int only.\n", parser->look_ahead);
-            return false;
+            state = false;
+            break;
         }
-    }
 
-    if (!expression_prime(parser, exp))
-    {
-        return false;
-    }
-
-    return true;
-}
-
-/*
- * <expression_prime> ::=
- *      & <arith_op> <expression_prime>
- *    | | <arith_op> <expression_prime>
- *    | null
- */
-bool expression_prime(parser_T* parser, Symbol* exp)
-{
-    switch (parser->look_ahead->type)
-    {
-        case T_AND:
-            parser_eat(parser, T_AND);
-            break;
-        case T_OR:
-            parser_eat(parser, T_OR);
-            break;
-        // null case
-        default:
-            return true;
-    }
-
-    Symbol rhs = *init_symbol();
-
-    if (!arith_op(parser, &rhs))
-    {
-        throw_error("Missing operand\n", parser->look_ahead);
-        return false;
-    }
-
-    // Type checking and convert type for 'and', 'or' operators
-    expression_type_checking(parser, exp, &rhs, parser->look_ahead);
+        // Fold the operators that bind at least as tight as the next one,
+        // closing every group that ends after this operand
+        Precedence prec = operator_precedence(parser->look_ahead->type);
+        while (true)
+        {
+            if (!reduce_group(parser, &operand, prec))
+            {
+                state = false;
+                break;
+            }
+            else if (prec != PREC_NONE)
+            {
+                break;
+            }
 
-    if (!expression_prime(parser, exp))
-    {
-        return false;
-    }
+            // End of the group
+            parser->group_count--;
+            if (parser->group_count == group_base)
+            {
+                *exp = operand;
+                return true;
+            }
 
-    return true;
-}
+            if (!parser_eat(parser, T_RPAREN))
+            {
+                throw_error(parser->compiler, "Missing \')\' in expression factor\n", parser->look_ahead);
+                state = false;
+                break;
+            }
+            prec = operator_precedence(parser->look_ahead->type);
+        }
 
-/*
- * <arith_op> ::= <relation> <arith_op_prime>
- */
-bool arith_op(parser_T* parser, Symbol* op)
-{
-    if (!relation(parser, op))
-    {
-        return false;
+        if (state)
+        {
+            push_op(parser, operand, parser->look_ahead->type, prec);
+            parser_eat(parser, parser->look_ahead->type);
+            group_start = false;
+        }
     }
 
-    if (!arith_op_prime(parser, op))
+    // Every operator still waiting for its right operand reports it missing
+    while (parser->op_count > op_base)
     {
-        return false;
+        Precedence prec = parser->ops[--parser->op_count].prec;
+        throw_error(parser->compiler, prec == PREC_RELATION ? "Missing operand.\n" : "Missing operand\n", parser->look_ahead);
     }
-    return true;
+    parser->group_count = group_base;
+    return false;
 }
 
 /*
- * <arith_op_prime> ::=
- *      + <relation> <arith_op_prime>
- *    | - <relation> <arith_op_prime>
- *    | null
+ * Level of a binary operator, PREC_NONE if the token is not one
  */
-bool arith_op_prime(parser_T* parser, Symbol* ar_op)
+Precedence operator_precedence(TokenType type)
 {
-    Token op = *parser->look_ahead;
-    switch (parser->look_ahead->type)
+    switch (type)
     {
+        case T_AND:
+        case T_OR:
+            return PREC_EXPRESSION;
         case T_PLUS:
-            parser_eat(parser, T_PLUS);
-            break;
         case T_MINUS:
-            parser_eat(parser, T_MINUS);
-            break;
-        default:
-            return true;
-    }
-
-    Symbol rhs = *init_symbol();
-
-    if (!relation(parser, &rhs))
-    {
-        throw_error("Missing operand\n", parser->look_ahead);
-        return false;
-    }
-
-    // Type checking to convert type for + -
-    if (!arithmetic_type_checking(parser, ar_op, &rhs, &op))
-    {
-        return false;
-    }
-
-    if (!arith_op_prime(parser, ar_op))
-    {
-        return false;
-    }
-
-    return true;
-}
-
-/*
- * <relation> ::= <term> <relation_prime>
- */
-bool relation(parser_T* parser, Symbol* rel)
-{
-    if (!term(parser, rel))
-    {
-        return false;
-    }
-
-    if (!relation_prime(parser, rel))
-    {
-        return false;
-    }
-
-    return true;
-}
-
-/*
- * <relation_prime> ::=
- *          <   <term> <relation_prime>
- *        | >=  <term> <relation_prime>
- *        | >   <term> <relation_prime>
- *        | <=  <term> <relation_prime>
- *        | ==  <term> <relation_prime>
- *        | !=  <term> <relation_prime>
- *        | null
- */
-bool relation_prime(parser_T* parser, Symbol* rel)
-{
-    Token op = *parser->look_ahead;
-    
-    switch (parser->look_ahead->type)
-    {
+            return PREC_ARITH_OP;
         case T_LT:
-            parser_eat(parser, T_LT);
-            break;
         case T_LTEQ:
-            parser_eat(parser, T_LTEQ);
-            break;
         case T_GT:
-            parser_eat(parser, T_GT);
-            break;
         case T_GTEQ:
-            parser_eat(parser, T_GTEQ);
-            break;
         case T_EQ:
-            parser_eat(parser, T_EQ);
-            break;
         case T_NOT_EQ:
-            parser_eat(parser, T_NOT_EQ);
-            break;
+            return PREC_RELATION;
+        case T_MULTIPLY:
+        case T_DIVIDE:
+            return PREC_TERM;
         default:
-            return true;
+            return PREC_NONE;
     }
+}
 
-    Symbol rhs = *init_symbol();
-
+/*
+ * Operators of one level are left associative, each level binds
+ * tighter than the one before it:
+ *
+ * <expression_prime> ::= ( & | '|' ) <arith_op> <expression_prime> | null
+ * <arith_op>         ::= <relation> <arith_op_prime>
+ * <arith_op_prime>   ::= ( + | - ) <relation> <arith_op_prime> | null
+ * <relation>         ::= <term> <relation_prime>
+ * <relation_prime>   ::= ( < | >= | > | <= | == | != ) <term> <relation_prime> | null
+ * <term>             ::= <factor> <term_prime>
+ * <term_prime>       ::= ( * | / ) <factor> <term_prime> | null
+ *
+ * Fold the pending operators of the innermost group into operand, from
+ * the top down to the first one that binds looser than prec.
+ * The group's NOT applies to its first <arith_op>, so it is folded
+ * in before any & or |.
+ */
+bool reduce_group(parser_T* parser, Value* operand, Precedence prec)
+{
+    ExprGroup* group = &parser->groups[parser->group_count - 1];
 
-    if (!term(parser, &rhs))
+    if (prec > PREC_EXPRESSION)
     {
-        throw_error("Missing operand.\n", parser->look_ahead);
-        return false;
+        return fold_ops(parser, group->base, operand, prec);
     }
 
-    // Type checking to convert type for relational operators
-    if (!relation_type_checking(parser, rel, &rhs, &op))
+    if (!fold_ops(parser, group->base, operand, PREC_ARITH_OP))
     {
         return false;
     }
 
-    // Relation successfully evaluates to boolean
-    rel->type = TC_BOOL;
+    // Type checking for not operator
+    // Valid:
+    // bool
+    // int
 
-    if (!relation_prime(parser, rel))
+    if (group->not_flag)
     {
-        return false;
+        group->not_flag = false;
+        if (operand->type == TC_BOOL || operand->type == TC_INT)
+        {
+            operand->node = unary_node(parser, NODE_NOT, operand);
+        }
+        else
+        {
+            throw_error(parser->compiler, "!= operator is defined for bool and int only.\n", parser->look_ahead);
+            return false;
+        }
     }
 
-    return true;
+    return fold_ops(parser, group->base, operand, PREC_EXPRESSION);
 }
 
 /*
- * <term> ::= <factor> <term_prime>
+ * Apply the pending operators above base with level min_prec or higher,
+ * operand is the right operand of the topmost one and holds the result
  */
-bool term(parser_T* parser, Symbol* tm)
+bool fold_ops(parser_T* parser, unsigned int base, Value* operand, Precedence min_prec)
 {
-    if (!factor(parser, tm))
+    while (parser->op_count > base && parser->ops[parser->op_count - 1].prec >= min_prec)
     {
-        return false;
-    }
+        PendingOp pending = parser->ops[--parser->op_count];
+        Token op;
+        init_token(&op, pending.op);
 
-    if (!term_prime(parser, tm))
-    {
-        return false;
-    }
+        switch (pending.prec)
+        {
+            case PREC_EXPRESSION:
+                // Type checking and convert type for 'and', 'or' operators
+                if (!expression_type_checking(parser, &pending.lhs, operand, &op))
+                {
+                    return false;
+                }
+                break;
+            case PREC_RELATION:
+                // Type checking to convert type for relational operators
+                if (!relation_type_checking(parser, &pending.lhs, operand, &op))
+                {
+                    return false;
+                }
 
+                // Relation successfully evaluates to boolean
+                pending.lhs.type = TC_BOOL;
+                break;
+            default:
+                // Type checking to convert type for + - * /
+                if (!arithmetic_type_checking(parser, &pending.lhs, operand, &op))
+                {
+                    return false;
+                }
+                break;
+        }
+        *operand = pending.lhs;
+    }
     return true;
 }
 
-/*
- * <term_prime> ::=
- *       *  <factor> <term_prime>
- *     | /  <factor> <term_prime>
- *     | null
- */
-bool term_prime(parser_T* parser, Symbol* tm)
+void push_group(parser_T* parser)
 {
-    Token op = *parser->look_ahead;
-    switch (parser->look_ahead->type)
-    {
-        case T_MULTIPLY:
-            parser_eat(parser, T_MULTIPLY);
-            break;
-        case T_DIVIDE:
-            parser_eat(parser, T_DIVIDE);
-            break;
-        default:
-            return true;
-    }
-
-    Symbol rhs = *init_symbol();
-
-    if (!factor(parser, &rhs))
+    if (parser->group_count == parser->group_capacity)
     {
-        throw_error("Missing operand\n", parser->look_ahead);
-        return false;
+        parser->group_capacity = parser->group_capacity == 0 ? PARSE_STACK_INITIAL_CAPACITY : parser->group_capacity * 2;
+        parser->groups = realloc(parser->groups, parser->group_capacity * sizeof(ExprGroup));
     }
+    parser->groups[parser->group_count].base = parser->op_count;
+    parser->groups[parser->group_count].not_flag = false;
+    parser->group_count++;
+}
 
-    // Type checking to convert type for * / operation
-    if (!arithmetic_type_checking(parser, tm, &rhs, &op))
+void push_op(parser_T* parser, Value lhs, TokenType op, Precedence prec)
+{
+    if (parser->op_count == parser->op_capacity)
     {
-        return false;
+        parser->op_capacity = parser->op_capacity == 0 ? PARSE_STACK_INITIAL_CAPACITY : parser->op_capacity * 2;
+        parser->ops = realloc(parser->ops, parser->op_capacity * sizeof(PendingOp));
     }
-
-    if (!term_prime(parser, tm))
-    {
-        return false;
-    }
-
-    return true;
+    parser->ops[parser->op_count].lhs = lhs;
+    parser->ops[parser->op_count].op = op;
+    parser->ops[parser->op_count].prec = prec;
+    parser->op_count++;
 }
 
 /*
@@ -1561,25 +1380,12 @@ bool term_prime(parser_T* parser, Symbol* tm)
  *    | <string>
  *    | true
  *    | false
+ *
+ * ( <expression> ) is parsed by expression itself
  */
-bool factor(parser_T* parser, Symbol* fac)
+bool factor(parser_T* parser, Value* fac)
 {
-    if (is_token_type(parser, T_LPAREN))
-    {
-        parser_eat(parser, T_LPAREN);
-        if (!expression(parser, fac))
-        {
-            return false;
-        }
-
-        if (!parser_eat(parser, T_RPAREN))
-        {
-            throw_error("Missing \')\' in expression factor\n", parser->look_ahead);
-            return false;
-        }
-        return true;
-    }
-    else if (procedure_call_or_name_handler(parser, fac))
+    if (procedure_call_or_name_handler(parser, fac))
     {
         // nothing
     }
@@ -1588,24 +1394,20 @@ bool factor(parser_T* parser, Symbol* fac)
         parser_eat(parser, T_MINUS);
         if (name(parser, fac) || number(parser, fac))
         {
-            // Codegen: negative value
-            if (fac->type == TC_INT)
-            {
-                fac->llvm_value = LLVMBuildNeg(llvm_builder, fac->llvm_value, "");
-            }
-            else if (fac->type == TC_FLOAT)
+            // Negative value
+            if (fac->type == TC_INT || fac->type == TC_FLOAT)
             {
-                fac->llvm_value = LLVMBuildFNeg(llvm_builder, fac->llvm_value, "");
+                fac->node = unary_node(parser, NODE_NEGATE, fac);
             }
             else
             {
-                throw_error("Minus operator only valid on integers or floats\n", parser->look_ahead);
+                throw_error(parser->compiler, "Minus operator only valid on integers or floats\n", parser->look_ahead);
                 return false;
             }
         }
         else
         {
-            throw_error("Invalid use of minus operator\n", parser->look_ahead);
+            throw_error(parser->compiler, "Invalid use of minus operator\n", parser->look_ahead);
             return false;
         }
     }
@@ -1620,16 +1422,18 @@ bool factor(parser_T* parser, Symbol* fac)
     else if (is_token_type(parser, K_TRUE))
     {
         parser_eat(parser, K_TRUE);
-        fac->ttype = K_TRUE;
         fac->type = TC_BOOL;
-        fac->llvm_value = LLVMConstInt(int1_type, 1, 1);
+        fac->node = ast_add(parser->ast, NODE_BOOL);
+        parser->ast->nodes[fac->node].type = TC_BOOL;
+        parser->ast->nodes[fac->node].data.bool_val = true;
     }
     else if (is_token_type(parser, K_FALSE))
     {
         parser_eat(parser, K_FALSE);
-        fac->ttype = K_FALSE;
         fac->type = TC_BOOL;
-        fac->llvm_value = LLVMConstInt(int1_type, 0, 1);
+        fac->node = ast_add(parser->ast, NODE_BOOL);
+        parser->ast->nodes[fac->node].type = TC_BOOL;
+        parser->ast->nodes[fac->node].data.bool_val = false;
     }
     else {
         return false;
@@ -1645,23 +1449,22 @@ bool factor(parser_T* parser, Symbol* fac)
  * 
  * <name> ::= <identifier> [ [ <expression> ] ]
  */
-bool procedure_call_or_name_handler(parser_T* parser, Symbol* id)
+bool procedure_call_or_name_handler(parser_T* parser, Value* val)
 {
-    if (!identifier(parser, id))
+    const InternedString* id_name = is_token_type(parser, T_ID) ? parser->look_ahead->value.idVal : NULL;
+    if (!parser_eat(parser, T_ID))
     {
         return false;
     }
 
-    // Check if identifier is defined in local or global scope
-    if (!has_current_symbol(parser->sem, id->id))
+    // Get Identifier from local or global
+    Symbol* id = get_current_symbol(parser->sem, id_name);
+    if (id == NULL)
     {
-        throw_error(concatf("Identifier \'%s\' is not declared in local or global scope.\n", id->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Identifier \'%s\' is not declared in local or global scope.\n", id_name->str), parser->look_ahead);
         return false;
     }
 
-    // Get Identifier from local or global
-    *id = get_current_global_symbol(parser->sem, id->id, id->is_global);
-
     if (is_token_type(parser, T_LPAREN))
     {
         parser_eat(parser, T_LPAREN);
@@ -1669,26 +1472,29 @@ bool procedure_call_or_name_handler(parser_T* parser, Symbol* id)
         // Confirmation that it's a procedure
         if (id->stype != ST_PROCEDURE)
         {
-            throw_error(concatf("\'%s\' is not a procedure, and cannot be called.\n", id->id), parser->look_ahead);
+            throw_error(parser->compiler, concatf("\'%s\' is not a procedure, and cannot be called.\n", id->id), parser->look_ahead);
             return false;
         }
 
         // Optional argument
-        LLVMValueRef *args = NULL;
-        args = argument_list(parser, id);
-        if (error_flag)
+        NodeIndex args = argument_list(parser, id);
+        if (parser->compiler->error_flag)
         {
             return false;
         }
 
         if (!parser_eat(parser, T_RPAREN))
         {
-            throw_error("Missing \')\' in procedure call.\n", parser->look_ahead);
+            throw_error(parser->compiler, "Missing \')\' in procedure call.\n", parser->look_ahead);
             return false;
         }
 
-        // Codegen: Procedure call
-        id->llvm_value = LLVMBuildCall(llvm_builder, id->llvm_function, args, params_size(id), "");
+        *val = init_value_from_symbol(id);
+        val->node = ast_add(parser->ast, NODE_CALL);
+        Node* node = &parser->ast->nodes[val->node];
+        node->type = id->type;
+        node->lhs = args;
+        node->data.symbol = id;
 
     }
     else
@@ -1696,21 +1502,19 @@ bool procedure_call_or_name_handler(parser_T* parser, Symbol* id)
         // Confirm that it's a name
         if (id->stype != ST_VARIABLE)
         {
-            throw_error(concatf("\'%s\' is not a variable.\n", id->id), parser->look_ahead);
+            throw_error(parser->compiler, concatf("\'%s\' is not a variable.\n", id->id), parser->look_ahead);
             return false;
         }
 
         // Optional array index
-        Symbol ind = *init_symbol();
-        if (!array_index(parser, id, &ind))
+        *val = init_value_from_symbol(id);
+        Value ind = init_value();
+        if (!array_index(parser, id, val, &ind))
         {
             return false;
         }
 
-        if (!name_code_gen(parser, id, &ind))
-        {
-            return false;
-        }
+        name_node(parser, NODE_NAME, id, val, &ind);
     }
     return true;
 }
@@ -1718,47 +1522,44 @@ bool procedure_call_or_name_handler(parser_T* parser, Symbol* id)
 /*
  * <name> ::= <identifier> [ [ <expression> ] ]
  */
-bool name(parser_T* parser, Symbol* id)
+bool name(parser_T* parser, Value* val)
 {
-    if (!identifier(parser, id))
+    const InternedString* id_name = is_token_type(parser, T_ID) ? parser->look_ahead->value.idVal : NULL;
+    if (!parser_eat(parser, T_ID))
     {
         return false;
     }
 
-    // Check if identifier is in local or global scope
-    if (!has_current_symbol(parser->sem, id->id))
+    // Get Id
+    Symbol* id = get_current_symbol(parser->sem, id_name);
+    if (id == NULL)
     {
-        throw_error(concatf("Identifier \'%s\' is not declared in local or global scope.\n", id->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("Identifier \'%s\' is not declared in local or global scope.\n", id_name->str), parser->look_ahead);
         return false;
     }
 
-    // Get Id
-    *id = get_current_global_symbol(parser->sem, id->id, id->is_global);
-
     // Confirm that it is a name
     if (id->stype != ST_VARIABLE)
     {
-        throw_error(concatf("\'%s\' is not a variable.\n", id->id), parser->look_ahead);
+        throw_error(parser->compiler, concatf("\'%s\' is not a variable.\n", id->id), parser->look_ahead);
         return false;
     }
 
-    Symbol ind = *init_symbol();
-    if (!array_index(parser, id, &ind))
+    *val = init_value_from_symbol(id);
+    Value ind = init_value();
+    if (!array_index(parser, id, val, &ind))
     {
         return false;
     }
 
-    if (!name_code_gen(parser, id, &ind))
-    {
-        return false;
-    }
+    name_node(parser, NODE_NAME, id, val, &ind);
     return true;
 }
 
 /*
  * Handler for array index [ [ <expression> ] ]
  */
-bool array_index(parser_T* parser, Symbol* id, Symbol* ind)
+bool array_index(parser_T* parser, Symbol* id, Value* val, Value* ind)
 {
     if (parser_eat(parser, T_LBRACKET))
     {
@@ -1770,63 +1571,38 @@ bool array_index(parser_T* parser, Symbol* id, Symbol* ind)
         // Check valid array access
         if (!id->is_arr)
         {
-            throw_error(concatf("Identifier \'%s\' is not an array. Invalid array access.\n", id->id), parser->look_ahead);
+            throw_error(parser->compiler, concatf("Identifier \'%s\' is not an array. Invalid array access.\n", id->id), parser->look_ahead);
             return false;
         }
         else if (ind->type != TC_INT)
         {
-            throw_error("Array index must be integer.\n", parser->look_ahead);
+            throw_error(parser->compiler, "Array index must be integer.\n", parser->look_ahead);
             return false;
         }
 
-        // Code gen: check 0 <= exp value < arr bound
-        LLVMValueRef zero_val = LLVMConstInt(int32_type, 0, true);
-        LLVMValueRef bound_val = LLVMConstInt(int32_type, id->arr_size, true);
-        LLVMValueRef lt_bound = LLVMBuildICmp(llvm_builder, LLVMIntSLT, ind->llvm_value, bound_val, "");
-        LLVMValueRef gte_zero = LLVMBuildICmp(llvm_builder, LLVMIntSGE, ind->llvm_value, zero_val, "");
-        LLVMValueRef cond = LLVMBuildAnd(llvm_builder, lt_bound, gte_zero, "");
-
-        LLVMValueRef func = get_current_procedure(parser->sem).llvm_function;
-        LLVMBasicBlockRef bound_err_block = LLVMAppendBasicBlockInContext(llvm_context, func, "boundErr");
-        LLVMBasicBlockRef no_err_block = LLVMAppendBasicBlockInContext(llvm_context, func, "noErr");
-
-        // If invalid index, display error and exit
-        LLVMBuildCondBr(llvm_builder, cond, no_err_block, bound_err_block);
-        LLVMPositionBuilderAtEnd(llvm_builder, bound_err_block);
-        LLVMValueRef err_func = get_current_global_symbol(parser->sem, "_outOfBoundsError", true).llvm_function;
-        LLVMBuildCall(llvm_builder, err_func, NULL, 0, "");
-        // Need a terminator to satisfy LLVM, but it will exit(1) before reaching
-        LLVMBuildBr(llvm_builder, no_err_block);
-        LLVMPositionBuilderAtEnd(llvm_builder, no_err_block);
-
-        id->is_indexed = true;
+        val->is_indexed = true;
 
         if (!parser_eat(parser, T_RBRACKET))
         {
-            throw_error("Missing \']\' in array index access.\n", parser->look_ahead);
+            throw_error(parser->compiler, "Missing \']\' in array index access.\n", parser->look_ahead);
             return false;
         }
     }
     return true;
 }
 
-bool name_code_gen(parser_T* parser, Symbol* id, Symbol* ind)
+/*
+ * Node for a use of id, the bound of an index is checked when it runs
+ */
+void name_node(parser_T* parser, NodeKind kind, Symbol* id, Value* val, Value* ind)
 {
-    if (id->is_arr) {
-        if (!id->is_indexed) {
-            // Either passing whole array as arg, or doing fancy array assignment
-            return true;
-        }
-
-        LLVMValueRef zero_val = LLVMConstInt(int32_type, 0, true);
-        
-        // Get pointer to the element of the array
-        LLVMValueRef indices[] = { zero_val, ind->llvm_value};
-        id->llvm_address = LLVMBuildInBoundsGEP(llvm_builder, id->llvm_address, indices, 2, "");
-    }
-    id->llvm_value = NULL;
-    id->llvm_value = LLVMBuildLoad2(llvm_builder, create_llvm_type(id->type), id->llvm_address, "");
-    return true;
+    val->node = ast_add(parser->ast, kind);
+    Node* node = &parser->ast->nodes[val->node];
+    node->type = val->type;
+    node->is_arr = val->is_arr && !val->is_indexed;
+    node->arr_size = val->arr_size;
+    node->lhs = val->is_indexed ? ind->node : NO_NODE;
+    node->data.symbol = id;
 }
 
 /*
@@ -1834,120 +1610,97 @@ bool name_code_gen(parser_T* parser, Symbol* id, Symbol* ind)
  *      <expression>, <argument_list>
  *    | <expression>
  */
-LLVMValueRef* argument_list(parser_T* parser, Symbol* id)
+NodeIndex argument_list(parser_T* parser, Symbol* id)
 {
-    LLVMValueRef *arg_list = (LLVMValueRef *) malloc(sizeof(LLVMValueRef) * params_size(id));
-    Symbol arg = *init_symbol();
+    NodeIndex first = NO_NODE;
+    NodeIndex last = NO_NODE;
+    Value arg = init_value();
     int arg_index = 0;
 
     if (!expression(parser, &arg))
     {
         if (arg_index != params_size(id))
         {
-            throw_error(concatf("Too few arguments provided for \'%s\'.\n", id->id), parser->look_ahead);
+            throw_error(parser->compiler, concatf("Too few arguments provided for \'%s\'.\n", id->id), parser->look_ahead);
         }
-        return false;
+        return NO_NODE;
     }
 
-    // Grab parameter symbol at corresponding index
-    Symbol sym = get_nth_param(id, arg_index);
-
-    // Check for too much parameters 
-    if (arg_index >= params_size(id))
+    while (true)
     {
-        throw_error(concatf("Too many arguments provivded to \'%s\'.\n", id->id), parser->look_ahead);
-        return false;
-    }
-    // Type checking match parameter type
-    else if (!type_checking(parser, &sym, &arg))
-    {
-        return false;
-    }
-
-
-    int arg_list_idx = 0;
-    if (arg.is_arr && !arg.is_indexed)
-    {
-        // Passing the entire array as arg
-        // procedure_body will copy in the values to the local array
-        arg_list[arg_list_idx++] = arg.llvm_address;
-    }
-    else
-    {
-        arg_list[arg_list_idx++] = arg.llvm_value;
-    }
-
-    // Increment count
-    arg_index++;
-    
-
-    // Optional arguments
-    while (is_token_type(parser, T_COMMA))
-    {
-        arg = *init_symbol();
-        parser_eat(parser, T_COMMA);
-        if (!expression(parser, &arg))
-        {
-            throw_error("Invalid argument.\n", parser->look_ahead);
-            return false;
-        }
-
-        // Grab parameter symbol at corresponding index
-        sym = get_nth_param(id, arg_index);
-
         // Check for too much parameters 
         if (arg_index >= params_size(id))
         {
-            throw_error(concatf("Too many arguments provivded to \'%s\'.\n", id->id), parser->look_ahead);
-            return false;
+            throw_error(parser->compiler, concatf("Too many arguments provivded to \'%s\'.\n", id->id), parser->look_ahead);
+            return NO_NODE;
         }
         // Type checking match parameter type
-        else if (!type_checking(parser, &sym, &arg))
+        Value param_val = init_value_from_symbol(get_nth_param(id, arg_index));
+        Conversion conv = CONV_NONE;
+        if (!type_checking(parser, &param_val, &arg, &conv))
         {
-            return false;
+            return NO_NODE;
         }
 
-        if (arg.is_arr && !arg.is_indexed)
+        NodeIndex node = ast_add(parser->ast, NODE_ARGUMENT);
+        parser->ast->nodes[node].lhs = arg.node;
+        parser->ast->nodes[node].lhs_conv = conv;
+        if (last == NO_NODE)
         {
-            // Passing the entire array as arg
-            // procedure_body will copy in the values to the local array
-            arg_list[arg_list_idx++] = arg.llvm_address;
+            first = node;
         }
         else
         {
-            arg_list[arg_list_idx++] = arg.llvm_value;
+            parser->ast->nodes[last].next = node;
         }
+        last = node;
 
         // Increment count
         arg_index++;
+
+        // Optional arguments
+        if (!is_token_type(parser, T_COMMA))
+        {
+            break;
+        }
+
+        arg = init_value();
+        parser_eat(parser, T_COMMA);
+        if (!expression(parser, &arg))
+        {
+            throw_error(parser->compiler, "Invalid argument.\n", parser->look_ahead);
+            return NO_NODE;
+        }
     }
 
     // Check number of params
     if (arg_index != params_size(id)) {
-        throw_error(concatf("Too many arguments provivded to \'%s\'.\n", id->id), parser->look_ahead);
-        return false;
+        throw_error(parser->compiler, concatf("Too many arguments provivded to \'%s\'.\n", id->id), parser->look_ahead);
+        return NO_NODE;
     }
 
-    return arg_list;
+    return first;
 }
 
 /*
  * <number> ::= [0-9][0-9_]*[.[0-9_]*]
  */
-bool number(parser_T* parser, Symbol* num)
+bool number(parser_T* parser, Value* num)
 {
     if (is_token_type(parser, T_NUMBER_INT))
     {
         num->type = TC_INT;
-        num->ttype = T_NUMBER_INT;
-        num->llvm_value = LLVMConstInt(int32_type, parser->look_ahead->value.intVal, true);
+        num->node = ast_add(parser->ast, NODE_INT);
+        parser->ast->nodes[num->node].type = TC_INT;
+        parser->ast->nodes[num->node].data.int_val = parser->look_ahead->value.intVal;
         return parser_eat(parser, T_NUMBER_INT);
     }
     else if (is_token_type(parser, T_NUMBER_FLOAT))
     {
         num->type = TC_FLOAT;
-        num->ttype = T_NUMBER_FLOAT;
-        num->llvm_value =  LLVMConstReal(float_type, parser->look_ahead->value.floatVal);
+        num->node = ast_add(parser->ast, NODE_FLOAT);
+        parser->ast->nodes[num->node].type = TC_FLOAT;
+        parser->ast->nodes[num->node].data.float_val = parser->look_ahead->value.floatVal;
         return parser_eat(parser, T_NUMBER_FLOAT);
     }
     else {
@@ -1958,14 +1711,14 @@ bool number(parser_T* parser, Symbol* num)
 /*
  * <string> :: = "[^"]*"
  */
-bool string(parser_T* parser, Symbol* str)
+bool string(parser_T* parser, Value* str)
 {
     if (is_token_type(parser, T_STRING))
     {
-        str->id = parser->look_ahead->value.stringVal;
-        str->ttype = parser->look_ahead->type;
         str->type = TC_STRING;
-        str->llvm_value = LLVMBuildGlobalStringPtr(llvm_builder, parser->look_ahead->value.stringVal, "");
+        str->node = ast_add(parser->ast, NODE_STRING);
+        parser->ast->nodes[str->node].type = TC_STRING;
+        parser->ast->nodes[str->node].data.string_val = ast_copy_string(parser->ast, parser->look_ahead->value.stringVal);
     }
     // Eat token
     return parser_eat(parser, T_STRING);
@@ -1980,52 +1733,84 @@ bool declaration_list(parser_T* parser)
     // Zero or more declarations
     while (declaration(parser)) {
         if (!parser_eat(parser, T_SEMI_COLON)) {
-            throw_error("Missing \';\' after declaration\n", parser->look_ahead);
+            throw_error(parser->compiler, "Missing \';\' after declaration\n", parser->look_ahead);
             return false;
         }
     }
 
-    if (error_flag && resync(parser, tokens, 2))
+    if (parser->compiler->error_flag && resync(parser, tokens, 2))
     {
         return declaration_list(parser);
     }
-    return !error_flag;
+    return !parser->compiler->error_flag;
 }
 
 /*
  * A list of statements for ( <statement> ; )*
  */
-bool statement_list(parser_T* parser)
+bool statement_list(parser_T* parser, NodeIndex* list)
 {
     TokenType tokens[] = { K_END, T_SEMI_COLON };
-    // Zero or more statements
-    while(statement(parser))
+    unsigned int base = parser->block_count;
+    StatementList root = { NO_NODE, NO_NODE };
+    NodeIndex stmt = NO_NODE;
+
+    // Zero or more statements.
+    // The lists of nested if and loop statements are parsed here too,
+    // their blocks sit on parser->blocks instead of the C stack
+    StatementState state = statement(parser, STMT_ASSIGNMENT, &stmt);
+    while (true)
     {
-        if (!parser_eat(parser, T_SEMI_COLON))
+        if (state == STATEMENT_OPENED)
         {
-            throw_error("Missing \';\' after statement\n", parser->look_ahead);
-            return false;
+            state = statement(parser, STMT_ASSIGNMENT, &stmt);
+            continue;
         }
-    }
 
-    if (error_flag && resync(parser, tokens, 2))
-    {
-        return statement_list(parser);
+        bool list_state;
+        if (state == STATEMENT_DONE)
+        {
+            if (parser_eat(parser, T_SEMI_COLON))
+            {
+                append_statement(parser, base, &root, stmt);
+                state = statement(parser, STMT_ASSIGNMENT, &stmt);
+                continue;
+            }
+            throw_error(parser->compiler, "Missing \';\' after statement\n", parser->look_ahead);
+            list_state = false;
+        }
+        else if (parser->compiler->error_flag && resync(parser, tokens, 2))
+        {
+            // Start the list over after the error
+            state = statement(parser, STMT_ASSIGNMENT, &stmt);
+            continue;
+        }
+        else
+        {
+            list_state = !parser->compiler->error_flag;
+        }
+
+        if (parser->block_count == base)
+        {
+            *list = root.head;
+            return list_state;
+        }
+        state = end_block(parser, list_state, &stmt);
     }
-    return !error_flag;
 }
 
 /*
  * Type checking for relational operators < <= > >= == !=
  */
-bool relation_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op)
+bool relation_type_checking(parser_T* parser, Value* lhs, Value* rhs, Token* op)
 {
     bool compatible = false;
+    Conversion lhs_conv = CONV_NONE;
+    Conversion rhs_conv = CONV_NONE;
     // If int is present with float or bool, convert int to that type
     // Otherwise types must match exactly
 
     // Convert integer to float or bool for comparision
-    LLVMValueRef zero_val = LLVMConstInt(int32_type, 0, true);
     if ((lhs->is_arr && !lhs->is_indexed) || (rhs->is_arr && !rhs->is_indexed))
     {
         // Unindexed arrays do op on whole array
@@ -2038,15 +1823,14 @@ bool relation_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* o
             compatible = true;
             // Convert to boolean
             lhs->type = TC_BOOL;
-            // All non-zero values are true
-            lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntNE, lhs->llvm_value, zero_val, "");
+            lhs_conv = CONV_INT_TO_BOOL;
         }
         else if (rhs->type == TC_FLOAT)
         {
             compatible = true;
             //Convert to float
             lhs->type = TC_FLOAT;
-            lhs->llvm_value = LLVMBuildSIToFP(llvm_builder, lhs->llvm_value, float_type, "");
+            lhs_conv = CONV_INT_TO_FLOAT;
         }
         else if (rhs->type == TC_INT)
         {
@@ -2066,7 +1850,7 @@ bool relation_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* o
             compatible = true;
             // Convert rhs to float
             rhs->type = TC_FLOAT;
-            rhs->llvm_value = LLVMBuildSIToFP(llvm_builder, rhs->llvm_value, float_type, "");
+            rhs_conv = CONV_INT_TO_FLOAT;
         }
     }
     else if (lhs->type == TC_BOOL)
@@ -2081,8 +1865,7 @@ bool relation_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* o
             compatible = true;
             // Convert to bool
             rhs->type = TC_BOOL;
-            // All non-zero values are true
-            rhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntNE, rhs->llvm_value, zero_val, "");
+            rhs_conv = CONV_INT_TO_BOOL;
         }
     }
     else if (lhs->type == TC_STRING)
@@ -2096,163 +1879,29 @@ bool relation_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* o
 
     if (!compatible)
     {
-        throw_error("Types are not compatible for relational operations.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Types are not compatible for relational operations.\n", parser->look_ahead);
         return false;
     }
 
-    // Code generation
-    switch (op->type)
-    {
-        case T_LT:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFCmp(llvm_builder, LLVMRealOLT, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else if (lhs->type == TC_BOOL)
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntULT, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else // Int
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntSLT, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        case T_LTEQ:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFCmp(llvm_builder, LLVMRealOLE, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else if (lhs->type == TC_BOOL)
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntULE, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else // Int
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntSLE, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        case T_GT:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFCmp(llvm_builder, LLVMRealOGT, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else if (lhs->type == TC_BOOL)
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntUGT, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else // Int
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntSGT, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        case T_GTEQ:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFCmp(llvm_builder, LLVMRealOGE, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else if (lhs->type == TC_BOOL)
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntUGE, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else // Int
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntSGE, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        case T_EQ:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFCmp(llvm_builder, LLVMRealOEQ, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else if (lhs->type == TC_STRING)
-            {
-                lhs->llvm_value = string_comparison(parser, lhs, rhs);
-            }
-            else // Int or Bool
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntEQ, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        case T_NOT_EQ:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFCmp(llvm_builder, LLVMRealONE, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else if (lhs->type == TC_STRING)
-            {
-                lhs->llvm_value = LLVMBuildNot(llvm_builder, string_comparison(parser, lhs, rhs), "");
-            }
-            else // Int or Bool
-            {
-                lhs->llvm_value = LLVMBuildICmp(llvm_builder, LLVMIntNE, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        default:
-            throw_error("Invalid relational operator.\n", parser->look_ahead);
-            return false;
-    }
+    // Compared on the converted type of lhs
+    binary_node(parser, lhs, rhs, op->type, lhs_conv, rhs_conv);
     return compatible;
 }
 
-/*
- * Compare strings character by character. Return LLVM value for whether they are equal.
- */
-LLVMValueRef string_comparison(parser_T* parser, Symbol* lhs, Symbol* rhs)
-{
-    LLVMValueRef func = get_current_procedure(parser->sem).llvm_function;
-
-    LLVMBasicBlockRef str_cmp_block = LLVMAppendBasicBlockInContext(llvm_context, func, "strCmp");
-    LLVMBasicBlockRef str_cmp_merge_block = LLVMAppendBasicBlockInContext(llvm_context, func, "strCmpMerge");
-
-    // Initial index = 0
-    LLVMValueRef ind_addr = LLVMBuildAlloca(llvm_builder, create_llvm_type(TC_INT), "strCmpInd");
-    LLVMValueRef index = LLVMConstInt(int32_type, 0, true);
-    LLVMBuildStore(llvm_builder, index, ind_addr);
-
-    LLVMBuildBr(llvm_builder, str_cmp_block);
-    LLVMPositionBuilderAtEnd(llvm_builder, str_cmp_block);
-
-    index = LLVMBuildLoad2(llvm_builder, create_llvm_type(TC_INT), ind_addr, "");
-
-    // Get element pointer to string character, then load the character
-    LLVMValueRef lhs_char_address = LLVMBuildInBoundsGEP(llvm_builder, lhs->llvm_value, &index, 1, "");
-    LLVMValueRef rhs_char_address = LLVMBuildInBoundsGEP(llvm_builder, rhs->llvm_value, &index, 1, "");
-    LLVMValueRef lhs_char_value = LLVMBuildLoad2(llvm_builder, int8_type, lhs_char_address, "");
-    LLVMValueRef rhs_char_value = LLVMBuildLoad2(llvm_builder, int8_type, rhs_char_address, "");
-
-    // Compare lhs == rhs
-    LLVMValueRef cmp = LLVMBuildICmp(llvm_builder, LLVMIntEQ, lhs_char_value, rhs_char_value, "");
-
-    // Null terminator char \0
-    LLVMValueRef zero_val_8 = LLVMConstInt(int8_type, 0, true);
-
-    // See if one char is null terminator.
-    // Ignore the rhs char since if they're unequal it doesn't matter anyway
-    LLVMValueRef not_null_term = LLVMBuildICmp(llvm_builder, LLVMIntNE, lhs_char_value, zero_val_8, "");
-
-    // Increment index
-    LLVMValueRef increment = LLVMConstInt(int32_type, 1, true);
-    index = LLVMBuildAdd(llvm_builder, index, increment, "");
-    LLVMBuildStore(llvm_builder, index, ind_addr);
-
-    // Keep checking if not the end And lhs == rhs so far
-    LLVMValueRef and_cond = LLVMBuildAdd(llvm_builder, cmp, not_null_term, "");
-    LLVMBuildCondBr(llvm_builder, and_cond, str_cmp_block, str_cmp_merge_block);
-    LLVMPositionBuilderAtEnd(llvm_builder, str_cmp_merge_block);
-    return cmp;
-}
-
 /*
  * Type checkign for arithmetic operators + - * /
  */
-bool arithmetic_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op)
+bool arithmetic_type_checking(parser_T* parser, Value* lhs, Value* rhs, Token* op)
 {
     if ((lhs->type != TC_INT && lhs->type != TC_FLOAT) || (rhs->type != TC_INT && rhs->type != TC_FLOAT))
     {
-        throw_error("Arithmetic operators are only for int and float.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Arithmetic operators are only for int and float.\n", parser->look_ahead);
         return false;
     }
 
+    Conversion lhs_conv = CONV_NONE;
+    Conversion rhs_conv = CONV_NONE;
+
     if ((lhs->is_arr && !lhs->is_indexed) || (rhs->is_arr && !rhs->is_indexed))
     {
         // Unindexed arrays do op on the whole array
@@ -2264,7 +1913,7 @@ bool arithmetic_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token*
         {
             // Convert lhs to float
             lhs->type = TC_FLOAT;
-            lhs->llvm_value = LLVMBuildSIToFP(llvm_builder, lhs->llvm_value, float_type, "");
+            lhs_conv = CONV_INT_TO_FLOAT;
         }
         // Else, both are int, matched
     }
@@ -2274,66 +1923,19 @@ bool arithmetic_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token*
         {
             // Convert rhs to float
             rhs->type = TC_FLOAT;
-            rhs->llvm_value = LLVMBuildSIToFP(llvm_builder, rhs->llvm_value, float_type, "");
+            rhs_conv = CONV_INT_TO_FLOAT;
         }
         // Else, both are float, matched
     }
 
-    // Code gen
-    switch (op->type)
-    {
-        case T_PLUS:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFAdd(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else
-            {
-                lhs->llvm_value = LLVMBuildAdd(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        case T_MINUS:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFSub(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else
-            {
-                lhs->llvm_value = LLVMBuildSub(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        case T_MULTIPLY:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFMul(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else
-            {
-                lhs->llvm_value = LLVMBuildMul(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        case T_DIVIDE:
-            if (lhs->type == TC_FLOAT)
-            {
-                lhs->llvm_value = LLVMBuildFDiv(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            else
-            {
-                lhs->llvm_value = LLVMBuildSDiv(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            }
-            break;
-        default:
-            throw_error("Invalid arithmetic operator.\n", parser->look_ahead);
-            return false;
-    }
-
+    binary_node(parser, lhs, rhs, op->type, lhs_conv, rhs_conv);
     return true;
 }
 
 /*
  * Type checking for expression operators & |
  */
-bool expression_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op)
+bool expression_type_checking(parser_T* parser, Value* lhs, Value* rhs, Token* op)
 {
     bool compatible = false;
 
@@ -2348,7 +1950,7 @@ bool expression_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token*
 
     if (!compatible)
     {
-        throw_error("Expression operators are defined for bool and int only.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Expression operators are defined for bool and int only.\n", parser->look_ahead);
         return false;
     }
 
@@ -2358,70 +1960,18 @@ bool expression_type_checking(parser_T* parser, Symbol* lhs, Symbol* rhs, Token*
         return array_op_type_check(parser, lhs, rhs, op);
     }
 
-    // Code gen
-    switch (op->type)
-    {
-        case T_AND:
-            lhs->llvm_value = LLVMBuildAnd(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            break;
-        case T_OR:
-            lhs->llvm_value = LLVMBuildOr(llvm_builder, lhs->llvm_value, rhs->llvm_value, "");
-            break;
-        default:
-            throw_error("Invalid expression operator.\n", parser->look_ahead);
-            return false;
-    }
+    binary_node(parser, lhs, rhs, op->type, CONV_NONE, CONV_NONE);
     return compatible;
 }
 
-// Codegen to copy the elements from one array to another
-void array_assignment_codegen(parser_T* parser, Symbol* dest, Symbol* exp)
-{
-    LLVMValueRef func = get_current_procedure(parser->sem).llvm_function;
-
-    LLVMBasicBlockRef arr_copy_block = LLVMAppendBasicBlockInContext(llvm_context, func, "arrCopy");
-    LLVMBasicBlockRef arr_copy_merge_block = LLVMAppendBasicBlockInContext(llvm_context, func, "arrCopyMerge");
-
-    // Initial index = 0
-    LLVMValueRef ind_addr = LLVMBuildAlloca(llvm_builder, create_llvm_type(TC_INT), "arrCopyInd");
-    LLVMValueRef zero_val = LLVMConstInt(int32_type, 0, true);
-    LLVMValueRef index = zero_val;
-    LLVMBuildStore(llvm_builder, index, ind_addr);
-
-    // Max value of index is arr_size - 1
-    LLVMValueRef loop_end = LLVMConstInt(int32_type, dest->arr_size, true);
-    LLVMBuildBr(llvm_builder, arr_copy_block);
-    LLVMPositionBuilderAtEnd(llvm_builder, arr_copy_block);
-
-    index = LLVMBuildLoad2(llvm_builder, create_llvm_type(TC_INT), ind_addr, "");
-
-    LLVMValueRef indices[] = { zero_val, index };
-    // Get pointer to array element, and load the value
-    LLVMValueRef exp_elem_addr = LLVMBuildInBoundsGEP(llvm_builder, exp->llvm_address, indices, 2, "");
-    LLVMValueRef exp_elem_val = LLVMBuildLoad2(llvm_builder, create_llvm_type(dest->type), exp_elem_addr, "");
-
-    // Get pointer to dest array element, and store the value
-    LLVMValueRef dest_elem_addr = LLVMBuildInBoundsGEP(llvm_builder, dest->llvm_address, indices, 2, "");
-    LLVMBuildStore(llvm_builder, exp_elem_val, dest_elem_addr);
-
-    // Increment index
-    LLVMValueRef increment = LLVMConstInt(int32_type, 1, true);
-    index = LLVMBuildAdd(llvm_builder, index, increment, "");
-    LLVMBuildStore(llvm_builder, index, ind_addr);
-
-    // index < arr size
-    LLVMValueRef cond = LLVMBuildICmp(llvm_builder, LLVMIntSLT, index, loop_end, "");
-    LLVMBuildCondBr(llvm_builder, cond, arr_copy_block, arr_copy_merge_block);
-    LLVMPositionBuilderAtEnd(llvm_builder, arr_copy_merge_block);
-}
-
 /*
  * Type checking for assignment operator
  * making destination and return type matches.
- * Also, matching parameters to arguments 
+ * Also, matching parameters to arguments.
+ * conv is set to the conversion the value of exp needs.
  */
 
-bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
+bool type_checking(parser_T* parser, Value* dest, Value* exp, Conversion* conv)
 {
     bool compatible = false;
 
@@ -2442,7 +1992,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
 
             if (dest->is_indexed != exp->is_indexed)
             {
-                throw_error("Incompatible index match of arrays.\n", parser->look_ahead);
+                throw_error(parser->compiler, "Incompatible index match of arrays.\n", parser->look_ahead);
                 return false;
             }
             else if (!dest->is_indexed)
@@ -2450,7 +2000,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
                 // Both are unindexed. Array lengths must match
                 if (dest->arr_size != exp->arr_size)
                 {
-                    throw_error("Array lengths must match.\n", parser->look_ahead);
+                    throw_error(parser->compiler, "Array lengths must match.\n", parser->look_ahead);
                     return false;
                 }
             }
@@ -2458,7 +2008,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
             {
                 if (dest->type != exp->type)
                 {
-                    throw_error("Unindexed array types must match each other.\n", parser->look_ahead);
+                    throw_error(parser->compiler, "Unindexed array types must match each other.\n", parser->look_ahead);
                     return false;
                 }
             }
@@ -2469,7 +2019,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
             // Array must be indexed
             if ((dest->is_arr && !dest->is_indexed) || (exp->is_arr && !exp->is_indexed))
             {
-                throw_error("Array is not indexed.\n", parser->look_ahead);
+                throw_error(parser->compiler, "Array is not indexed.\n", parser->look_ahead);
                 compatible = false;
             }
         }
@@ -2498,7 +2048,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
             {
                 // Convert exp to int
                 exp->type = TC_INT;
-                exp->llvm_value = LLVMConstIntCast(exp->llvm_value, int32_type, false);
+                *conv = CONV_CONST_BOOL_TO_INT;
             }
         }
         else if (exp->type == TC_FLOAT)
@@ -2508,7 +2058,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
             {
                 // Convert exp to int
                 exp->type = TC_INT;
-                exp->llvm_value = LLVMConstFPToSI(exp->llvm_value, int32_type);
+                *conv = CONV_CONST_FLOAT_TO_INT;
             }
         }
     }
@@ -2522,7 +2072,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
             {
                 // Convert exp to float
                 exp->type = TC_FLOAT;
-                exp->llvm_value = LLVMConstSIToFP(exp->llvm_value, float_type);
+                *conv = CONV_CONST_INT_TO_FLOAT;
             }
         }
     }
@@ -2536,7 +2086,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
             {
                 // Convert exp to bool
                 exp->type = TC_BOOL;
-                exp->llvm_value = LLVMConstICmp(LLVMIntNE , exp->llvm_value, LLVMConstInt(int32_type, 0, true));
+                *conv = CONV_CONST_INT_TO_BOOL;
             }
         }
     }
@@ -2544,7 +2094,7 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
 
     if (!compatible)
     {
-        throw_error(concatf(                           \
+        throw_error(parser->compiler, concatf(                           \
             "Incompatible types \'%s\' and \'%s\'.\n", \
             print_type_class(dest->type),              \
             print_type_class(exp->type)                \
@@ -2557,19 +2107,18 @@ bool type_checking(parser_T* parser, Symbol* dest, Symbol* exp)
 /*
  * Ops done on unindexed arrays affect the whole array
  */
-bool array_op_type_check(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op)
+bool array_op_type_check(parser_T* parser, Value* lhs, Value* rhs, Token* op)
 {
     // If both are arrays, size must be the same
     if (lhs->is_arr && !lhs->is_indexed && rhs->is_arr && !rhs->is_indexed && lhs->arr_size != rhs->arr_size)
     {
-        throw_error("Operation with unindexed arrays must have the same size.\n", parser->look_ahead);
+        throw_error(parser->compiler, "Operation with unindexed arrays must have the same size.\n", parser->look_ahead);
         return false;
     }
 
     // Get the correct type for the array
     // No need to check every type matching here.
     // Error will be thrown from type_checking function if invalid matches.
-    LLVMTypeRef ty;
     TypeClass output_type;
     switch (op->type)
     {
@@ -2580,12 +2129,10 @@ bool array_op_type_check(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op)
             if (lhs->type == TC_FLOAT || rhs->type == TC_FLOAT)
             {
                 output_type = TC_FLOAT;
-                ty = create_llvm_type(TC_FLOAT);
             }
             else
             {
                 output_type = TC_INT;
-                ty = create_llvm_type(TC_INT);
             }
             break;
         case T_LT:
@@ -2595,23 +2142,20 @@ bool array_op_type_check(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op)
         case T_EQ:
         case T_NOT_EQ:
             output_type = TC_BOOL;
-            ty = create_llvm_type(TC_BOOL);
             break;
         case T_AND:
         case T_OR:
             if (lhs->type == TC_BOOL)
             {
                 output_type = TC_BOOL;
-                ty = create_llvm_type(TC_BOOL);
             }
             else
             {
                 output_type = TC_INT;
-                ty = create_llvm_type(TC_INT);
             }
             break;
         default:
-            throw_error("Invalid unindexed array operator.\n", parser->look_ahead);
+            throw_error(parser->compiler, "Invalid unindexed array operator.\n", parser->look_ahead);
             return false;
     }
 
@@ -2621,54 +2165,12 @@ bool array_op_type_check(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op)
         arr_size = rhs->arr_size;
     }
 
-    ty = LLVMArrayType(ty, arr_size);
-
-    // Allocate a new array to store the result
-    LLVMValueRef result_arr_address = LLVMBuildAlloca(llvm_builder, ty, "");
-
-    LLVMValueRef func = get_current_procedure(parser->sem).llvm_function;
-    LLVMBasicBlockRef arr_op_block = LLVMAppendBasicBlockInContext(llvm_context, func, "arrOp");
-    LLVMBasicBlockRef arr_op_merge_block = LLVMAppendBasicBlockInContext(llvm_context, func, "arrOpMerge");
-
-    // Intial index = 0
-    LLVMValueRef ind_addr = LLVMBuildAlloca(llvm_builder, create_llvm_type(TC_INT), "arrOpInd");
-    LLVMValueRef zero_val = LLVMConstInt(int32_type, 0, true);
-    LLVMValueRef index = zero_val;
-    LLVMBuildStore(llvm_builder, index, ind_addr);
-
-    // Max value of index is arr_size - 1
-    LLVMValueRef loop_end = LLVMConstInt(int32_type, arr_size, true);
-
-    LLVMBuildBr(llvm_builder, arr_op_block);
-    LLVMPositionBuilderAtEnd(llvm_builder, arr_op_block);
-
-    index = LLVMBuildLoad2(llvm_builder, create_llvm_type(TC_INT), ind_addr, "");
-
-    // If the operand is an unindexed array, load the element of the current index
-    Symbol lhs_elem = *init_symbol_with_id_symbol_type("", lhs->ttype, lhs->stype, lhs->type);
-    LLVMValueRef indices[] = { zero_val, index };
-    if (lhs->is_arr && !lhs->is_indexed)
-    {
-        // Get pointer to array element, and load the value
-        LLVMValueRef elem_addr = LLVMBuildInBoundsGEP(llvm_builder, lhs->llvm_address, indices, 2, "");
-        lhs_elem.llvm_value = LLVMBuildLoad2(llvm_builder, create_llvm_type(lhs->type), elem_addr, "");
-    }
-    else
-    {
-        lhs_elem.llvm_value = lhs->llvm_value;
-    }
-
-    Symbol rhs_elem = *init_symbol_with_id_symbol_type("", rhs->ttype, rhs->stype, rhs->type);
-    if (rhs->is_arr && !rhs->is_indexed)
-    {
-        // Get pointer to array element, and load the value
-        LLVMValueRef elem_addr = LLVMBuildInBoundsGEP(llvm_builder, rhs->llvm_address, indices, 2, "");
-        rhs_elem.llvm_value = LLVMBuildLoad2(llvm_builder, create_llvm_type(rhs->type), elem_addr, "");
-    }
-    else
-    {
-        rhs_elem.llvm_value = rhs->llvm_value;
-    }
+    // The operator is checked on single elements,
+    // its node is applied to each element in turn
+    Value lhs_elem = init_value();
+    lhs_elem.type = lhs->type;
+    Value rhs_elem = init_value();
+    rhs_elem.type = rhs->type;
 
     switch (op->type)
     {
@@ -2700,32 +2202,54 @@ bool array_op_type_check(parser_T* parser, Symbol* lhs, Symbol* rhs, Token* op)
             }
             break;
         default:
-            throw_error("Invalid unindexed array operator.\n", parser->look_ahead);
+            throw_error(parser->compiler, "Invalid unindexed array operator.\n", parser->look_ahead);
             return false;
     }
 
+    NodeIndex index = ast_add(parser->ast, NODE_ARRAY_OP);
+    Node* node = &parser->ast->nodes[index];
+    node->op = op->type;
+    node->type = output_type;
+    node->is_arr = true;
+    node->arr_size = arr_size;
+    node->lhs = lhs->node;
+    node->rhs = rhs->node;
+    node->extra = lhs_elem.node;
 
-    // Get pointer to result array element, and store the result of the calculation
-    LLVMValueRef elem_addr = LLVMBuildInBoundsGEP(llvm_builder, result_arr_address, indices, 2, "");
-    LLVMBuildStore(llvm_builder, lhs_elem.llvm_value, elem_addr);
-
-    // Increment index
-    LLVMValueRef increment = LLVMConstInt(int32_type, 1, true);
-    index = LLVMBuildAdd(llvm_builder, index, increment, "");
-    LLVMBuildStore(llvm_builder, index, ind_addr);
-
-    // if index < array size
-    LLVMValueRef cond = LLVMBuildICmp(llvm_builder, LLVMIntSLT, index, loop_end, "");
-    LLVMBuildCondBr(llvm_builder, cond, arr_op_block, arr_op_merge_block);
-
-    LLVMPositionBuilderAtEnd(llvm_builder, arr_op_merge_block);
-
-    // Update the result symbol taht will be passed up
-    lhs->llvm_address = result_arr_address;
+    // Update the result value taht will be passed up
+    lhs->node = index;
     lhs->is_arr = true;
     lhs->is_indexed = false;
     lhs->arr_size = arr_size;
     lhs->type = output_type;
 
     return true;
-}
\ No newline at end of file
+}
+
+/*
+ * Node applying op to lhs and rhs, which becomes the node of lhs.
+ * The operator works on the type of lhs after conversion.
+ */
+void binary_node(parser_T* parser, Value* lhs, Value* rhs, TokenType op, Conversion lhs_conv, Conversion rhs_conv)
+{
+    NodeIndex index = ast_add(parser->ast, NODE_BINARY);
+    Node* node = &parser->ast->nodes[index];
+    node->op = op;
+    node->type = operator_precedence(op) == PREC_RELATION ? TC_BOOL : lhs->type;
+    node->operand_type = lhs->type;
+    node->lhs_conv = lhs_conv;
+    node->rhs_conv = rhs_conv;
+    node->lhs = lhs->node;
+    node->rhs = rhs->node;
+    lhs->node = index;
+}
+
+NodeIndex unary_node(parser_T* parser, NodeKind kind, Value* operand)
+{
+    NodeIndex index = ast_add(parser->ast, kind);
+    Node* node = &parser->ast->nodes[index];
+    node->type = operand->type;
+    node->operand_type = operand->type;
+    node->lhs = operand->node;
+    return index;
+}
@@ -1,102 +1,276 @@
 #include "include/scope.h"
+#include <string.h>
 
+#define INDEX_INITIAL_CAPACITY 64
+#define BINDINGS_INITIAL_CAPACITY 32
+#define SCOPES_INITIAL_CAPACITY 8
 
-Scope* init_scope()
+
+ScopeStack* init_scope_stack()
 {
-    Scope* new_scope = calloc(1, sizeof(struct Scope));
-    new_scope->table = NULL;    // To initiate hashtable, must first set it to null
-    new_scope->prev_scope = NULL;
-    return new_scope;
+    // Index and bindings allocate lazily on the first insert
+    ScopeStack* scopes = calloc(1, sizeof(struct ScopeStack));
+    scopes->scope_capacity = SCOPES_INITIAL_CAPACITY;
+    scopes->scope_starts = malloc(SCOPES_INITIAL_CAPACITY * sizeof(unsigned int));
+    scopes->scope_starts[GLOBAL_DEPTH] = 0;
+    scopes->depth = GLOBAL_DEPTH;
+    return scopes;
 }
 
-void free_scope(Scope* scope)
+void free_scope_stack(ScopeStack* scopes)
 {
-    if (scope != NULL)
+    if (scopes != NULL)
     {
-        free_symbol_table(scope);
-        free(scope);
-        scope = NULL;
+        free(scopes->slot_keys);
+        free(scopes->slot_heads);
+        free(scopes->bindings);
+        free(scopes->scope_starts);
+        free(scopes);
+        scopes = NULL;
     }
 }
 
-void set_symbol(Scope* scope, char* s, Symbol sym)
+/*
+ * Slot holding key, or the empty slot where it would be inserted
+ */
+static unsigned int find_slot(ScopeStack* scopes, const InternedString* key)
 {
-    SymbolTable* new_symbol = NULL;
+    unsigned int mask = scopes->slot_capacity - 1;
+    unsigned int idx = key->hash & mask;
 
-    new_symbol = calloc(1, sizeof(SymbolTable));
-    strcpy(new_symbol->id, s);
-    new_symbol->entry = sym;
-    HASH_ADD_STR(scope->table, id, new_symbol);
+    while (scopes->slot_keys[idx] != NULL && scopes->slot_keys[idx] != key)
+    {
+        idx = (idx + 1) & mask;
+    }
+    return idx;
 }
 
-void update_symbol(Scope* scope, char* s, Symbol sym)
+static void grow_index(ScopeStack* scopes)
 {
-    SymbolTable* new_symbol = NULL;
-    SymbolTable* tmp;
+    const InternedString** old_keys = scopes->slot_keys;
+    int* old_heads = scopes->slot_heads;
+    unsigned int old_capacity = scopes->slot_capacity;
+
+    scopes->slot_capacity = old_capacity == 0 ? INDEX_INITIAL_CAPACITY : old_capacity * 2;
+    scopes->slot_keys = calloc(scopes->slot_capacity, sizeof(InternedString*));
+    scopes->slot_heads = malloc(scopes->slot_capacity * sizeof(int));
 
-    new_symbol = calloc(1, sizeof(SymbolTable));
-    strcpy(new_symbol->id, s);
-    new_symbol->entry = sym;
-    HASH_REPLACE_STR(scope->table, id, new_symbol, tmp);
-    if (tmp != NULL)
+    for (unsigned int i = 0; i < old_capacity; i++)
     {
-        free(tmp);
+        if (old_keys[i] != NULL)
+        {
+            unsigned int idx = find_slot(scopes, old_keys[i]);
+            scopes->slot_keys[idx] = old_keys[i];
+            scopes->slot_heads[idx] = old_heads[i];
+        }
     }
+
+    free(old_keys);
+    free(old_heads);
 }
 
-Symbol get_symbol(Scope* scope, char* id)
+/*
+ * Innermost binding of key, or -1 if it is not bound in any open scope
+ */
+static int find_head(ScopeStack* scopes, const InternedString* key)
 {
-    if (has_symbol(scope, id))
+    if (scopes->slot_count == 0)
     {
-        SymbolTable* scope_table = NULL;
-        HASH_FIND_STR(scope->table, id, scope_table);
-        return scope_table->entry;
+        return -1;
     }
-    else
+
+    unsigned int idx = find_slot(scopes, key);
+    if (scopes->slot_keys[idx] == NULL)
+    {
+        return -1;
+    }
+    return scopes->slot_heads[idx];
+}
+
+/*
+ * Repoint whatever references binding from, the index head or
+ * the binding that shadows it, at binding to
+ */
+static void relink_binding(ScopeStack* scopes, int from, int to)
+{
+    unsigned int idx = find_slot(scopes, scopes->bindings[from].key);
+    int cur = scopes->slot_heads[idx];
+
+    if (cur == from)
+    {
+        scopes->slot_heads[idx] = to;
+        return;
+    }
+
+    while (scopes->bindings[cur].shadow != from)
+    {
+        cur = scopes->bindings[cur].shadow;
+    }
+    scopes->bindings[cur].shadow = to;
+}
+
+void push_scope(ScopeStack* scopes)
+{
+    scopes->depth++;
+    if (scopes->depth == scopes->scope_capacity)
+    {
+        scopes->scope_capacity *= 2;
+        scopes->scope_starts = realloc(scopes->scope_starts, scopes->scope_capacity * sizeof(unsigned int));
+    }
+    scopes->scope_starts[scopes->depth] = scopes->count;
+}
+
+/*
+ * Pop the innermost scope, the global scope is never popped.
+ * Bindings this scope declared for an enclosing scope, global
+ * declarations inside a procedure, are kept and moved down.
+ */
+void pop_scope(ScopeStack* scopes)
+{
+    if (scopes->depth == GLOBAL_DEPTH)
+    {
+        return;
+    }
+
+    unsigned int start = scopes->scope_starts[scopes->depth];
+
+    // Each binding of this scope is the head of its chain
+    for (unsigned int i = start; i < scopes->count; i++)
+    {
+        Binding* binding = &scopes->bindings[i];
+        if (binding->depth == scopes->depth)
+        {
+            scopes->slot_heads[find_slot(scopes, binding->key)] = binding->shadow;
+        }
+    }
+
+    unsigned int top = start;
+    for (unsigned int i = start; i < scopes->count; i++)
     {
-        Symbol ptr = *init_symbol();
-        set_symbol(scope, ptr.id, ptr);
-        return ptr;
+        if (scopes->bindings[i].depth < scopes->depth)
+        {
+            if (i != top)
+            {
+                relink_binding(scopes, i, top);
+                scopes->bindings[top] = scopes->bindings[i];
+            }
+            top++;
+        }
     }
+
+    scopes->count = top;
+    scopes->depth--;
 }
 
-bool has_symbol(Scope* scope, char* id)
+/*
+ * Insert or overwrite the binding of key in the open scope at depth
+ */
+void set_symbol(ScopeStack* scopes, const InternedString* key, Symbol sym, int depth)
 {
-    SymbolTable* scope_table = NULL;
-    HASH_FIND_STR(scope->table, id, scope_table);
+    // Keep the load factor under 1/2
+    if ((scopes->slot_count + 1) * 2 > scopes->slot_capacity)
+    {
+        grow_index(scopes);
+    }
 
-    if (scope_table == NULL)
+    unsigned int idx = find_slot(scopes, key);
+    if (scopes->slot_keys[idx] == NULL)
     {
-        return false;
+        scopes->slot_keys[idx] = key;
+        scopes->slot_heads[idx] = -1;
+        scopes->slot_count++;
+    }
+
+    // Find where a binding at depth sits in the chain
+    int prev = -1;
+    int cur = scopes->slot_heads[idx];
+    while (cur >= 0 && scopes->bindings[cur].depth > depth)
+    {
+        prev = cur;
+        cur = scopes->bindings[cur].shadow;
+    }
+
+    if (cur >= 0 && scopes->bindings[cur].depth == depth)
+    {
+        scopes->bindings[cur].symbol = sym;
+        return;
+    }
+
+    if (scopes->count == scopes->capacity)
+    {
+        scopes->capacity = scopes->capacity == 0 ? BINDINGS_INITIAL_CAPACITY : scopes->capacity * 2;
+        scopes->bindings = realloc(scopes->bindings, scopes->capacity * sizeof(Binding));
+    }
+
+    int new_binding = scopes->count++;
+    scopes->bindings[new_binding].key = key;
+    scopes->bindings[new_binding].depth = depth;
+    scopes->bindings[new_binding].shadow = cur;
+    scopes->bindings[new_binding].symbol = sym;
+
+    if (prev < 0)
+    {
+        scopes->slot_heads[idx] = new_binding;
     }
     else
     {
-        return true;
+        scopes->bindings[prev].shadow = new_binding;
     }
 }
 
-void print_symbol_table(Scope* scope)
+/*
+ * Binding of key in the open scope at depth, or NULL.
+ * Callers update the symbol through the pointer, it stays valid
+ * until the next insert or until the scope is popped.
+ */
+Symbol* get_symbol(ScopeStack* scopes, const InternedString* key, int depth)
 {
-    SymbolTable *s = NULL;
+    int cur = find_head(scopes, key);
+    while (cur >= 0 && scopes->bindings[cur].depth > depth)
+    {
+        cur = scopes->bindings[cur].shadow;
+    }
 
-    for (s = scope->table; s != NULL; s = (SymbolTable*)(s->hh.next))
+    if (cur >= 0 && scopes->bindings[cur].depth == depth)
     {
-        printf("Symbol type %s. symbol id: %s. symbol name: %s. symbol is %s\n", print_symbol_type(s->entry.stype), s->id, s->entry.id, print_type_class(s->entry.type));
+        return &scopes->bindings[cur].symbol;
     }
+    return NULL;
 }
 
-void free_symbol_table(Scope* scope)
+/*
+ * Binding of key visible from the innermost scope: its own, else the global one.
+ * Enclosing procedure scopes are not visible.
+ */
+Symbol* lookup_symbol(ScopeStack* scopes, const InternedString* key)
 {
-    SymbolTable *current_symbol, *tmp = NULL;
-    HASH_ITER(hh, scope->table, current_symbol, tmp) {
-        HASH_DEL(scope->table, current_symbol);
-        free(current_symbol);
+    for (int cur = find_head(scopes, key); cur >= 0; cur = scopes->bindings[cur].shadow)
+    {
+        int depth = scopes->bindings[cur].depth;
+        if (depth == scopes->depth || depth == GLOBAL_DEPTH)
+        {
+            return &scopes->bindings[cur].symbol;
+        }
     }
+    return NULL;
+}
+
+bool has_symbol(ScopeStack* scopes, const InternedString* key, int depth)
+{
+    return get_symbol(scopes, key, depth) != NULL;
 }
 
-unsigned int symbol_table_size(SymbolTable* table)
+void print_symbol_table(ScopeStack* scopes, int depth)
 {
-    unsigned int num_symbols;
-    num_symbols = HASH_COUNT(table);
-    return num_symbols;
+    for (unsigned int i = scopes->scope_starts[depth]; i < scopes->count; i++)
+    {
+        Binding* binding = &scopes->bindings[i];
+        if (binding->depth != depth)
+        {
+            continue;
+        }
+
+        Symbol* s = &binding->symbol;
+        printf("Symbol type %s. symbol id: %s. symbol name: %s. symbol is %s\n", print_symbol_type(s->stype), binding->key->str, s->id, print_type_class(s->type));
+    }
 }
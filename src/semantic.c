@@ -1,71 +1,41 @@
 #include "include/semantic.h"
 
 
-extern LLVMContextRef llvm_context;
-extern LLVMBuilderRef llvm_builder;
-extern LLVMModuleRef llvm_module;
-extern LLVMValueRef main_func;
-
-Semantic* init_semantic_analyzer()
+Semantic* init_semantic_analyzer(bp_compiler_T* compiler)
 {
     Semantic* sem = calloc(1, sizeof(struct Semantic));
-    sem->global = init_scope();
-    sem->current_local = sem->global;
+    sem->compiler = compiler;
+    sem->scopes = init_scope_stack();
+    sem->cur_proc_name = intern_cstr(&compiler->pool, _CUR_PROC);
 
     Symbol tmp;
 
-    // Initialize reserved word
-    set_symbol(sem->global, "program", *init_symbol_with_id_symbol_type("program", K_PROGRAM, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "is", *init_symbol_with_id_symbol_type("is", K_IS, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "begin", *init_symbol_with_id_symbol_type("begin", K_BEGIN, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "end", *init_symbol_with_id_symbol_type("end", K_END, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "global", *init_symbol_with_id_symbol_type("global", K_GLOBAL, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "variable", *init_symbol_with_id_symbol_type("variable", K_VARIABLE, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "procedure", *init_symbol_with_id_symbol_type("procedure", K_PROCEDURE, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "integer", *init_symbol_with_id_symbol_type("integer", K_INT, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "float", *init_symbol_with_id_symbol_type("float", K_FLOAT, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "bool", *init_symbol_with_id_symbol_type("bool", K_BOOL, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "string", *init_symbol_with_id_symbol_type("string", K_STRING, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "if", *init_symbol_with_id_symbol_type("if", K_IF, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "then", *init_symbol_with_id_symbol_type("then", K_THEN, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "else", *init_symbol_with_id_symbol_type("else", K_ELSE, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "for", *init_symbol_with_id_symbol_type("for", K_FOR, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "return", *init_symbol_with_id_symbol_type("return", K_RETURN, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "not", *init_symbol_with_id_symbol_type("not", K_NOT, ST_KEYWORD, TC_UNKNOWN));
-    set_symbol(sem->global, "true", *init_symbol_with_id_symbol_type("true", K_TRUE, ST_KEYWORD, TC_BOOL));
-    set_symbol(sem->global, "false", *init_symbol_with_id_symbol_type("false", K_FALSE, ST_KEYWORD, TC_BOOL));
-
     // Built-in functions
-    set_symbol(sem->global, "getbool", *init_symbol_with_id_symbol_type("getbool", T_ID, ST_PROCEDURE, TC_BOOL));
-    set_symbol(sem->global, "getinteger", *init_symbol_with_id_symbol_type("getinteger", T_ID, ST_PROCEDURE, TC_INT));
-    set_symbol(sem->global, "getfloat", *init_symbol_with_id_symbol_type("getfloat", T_ID, ST_PROCEDURE, TC_FLOAT));
-    set_symbol(sem->global, "getstring", *init_symbol_with_id_symbol_type("getstring", T_ID, ST_PROCEDURE, TC_STRING));
-    set_symbol(sem->global, "_outOfBoundsError", *init_symbol_with_id_symbol_type("_outOfBoundsError", T_ID, ST_PROCEDURE, TC_UNKNOWN));
-
-    tmp = *init_symbol_with_id_symbol_type("putbool", T_ID, ST_PROCEDURE, TC_BOOL);
-    tmp.params->symbol = *init_symbol_with_id_symbol_type("value", T_ID, ST_VARIABLE, TC_BOOL);
-    tmp.params->next_symbol = NULL;
-    set_symbol(sem->global, "putbool", tmp);
-
-    tmp = *init_symbol_with_id_symbol_type("putinteger", T_ID, ST_PROCEDURE, TC_BOOL);
-    tmp.params->symbol = *init_symbol_with_id_symbol_type("value", T_ID, ST_VARIABLE, TC_INT);
-    tmp.params->next_symbol = NULL;
-    set_symbol(sem->global, "putinteger", tmp);
-
-    tmp = *init_symbol_with_id_symbol_type("putfloat", T_ID, ST_PROCEDURE, TC_BOOL);
-    tmp.params->symbol = *init_symbol_with_id_symbol_type("value", T_ID, ST_VARIABLE, TC_FLOAT);
-    tmp.params->next_symbol = NULL;
-    set_symbol(sem->global, "putfloat", tmp);
-
-    tmp = *init_symbol_with_id_symbol_type("putstring", T_ID, ST_PROCEDURE, TC_BOOL);
-    tmp.params->symbol = *init_symbol_with_id_symbol_type("value", T_ID, ST_VARIABLE, TC_STRING);
-    tmp.params->next_symbol = NULL;
-    set_symbol(sem->global, "putstring", tmp);
-
-    tmp = *init_symbol_with_id_symbol_type("sqrt", T_ID, ST_PROCEDURE, TC_BOOL);
-    tmp.params->symbol = *init_symbol_with_id_symbol_type("value", T_ID, ST_VARIABLE, TC_INT);
-    tmp.params->next_symbol = NULL;
-    set_symbol(sem->global, "sqrt", tmp);
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "getbool"), *init_symbol_with_id_symbol_type(compiler, "getbool", T_ID, ST_PROCEDURE, TC_BOOL), GLOBAL_DEPTH);
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "getinteger"), *init_symbol_with_id_symbol_type(compiler, "getinteger", T_ID, ST_PROCEDURE, TC_INT), GLOBAL_DEPTH);
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "getfloat"), *init_symbol_with_id_symbol_type(compiler, "getfloat", T_ID, ST_PROCEDURE, TC_FLOAT), GLOBAL_DEPTH);
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "getstring"), *init_symbol_with_id_symbol_type(compiler, "getstring", T_ID, ST_PROCEDURE, TC_STRING), GLOBAL_DEPTH);
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "_outOfBoundsError"), *init_symbol_with_id_symbol_type(compiler, "_outOfBoundsError", T_ID, ST_PROCEDURE, TC_UNKNOWN), GLOBAL_DEPTH);
+
+    tmp = *init_symbol_with_id_symbol_type(compiler, "putbool", T_ID, ST_PROCEDURE, TC_BOOL);
+    add_param(compiler, &tmp, *init_symbol_with_id_symbol_type(compiler, "value", T_ID, ST_VARIABLE, TC_BOOL));
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "putbool"), tmp, GLOBAL_DEPTH);
+
+    tmp = *init_symbol_with_id_symbol_type(compiler, "putinteger", T_ID, ST_PROCEDURE, TC_BOOL);
+    add_param(compiler, &tmp, *init_symbol_with_id_symbol_type(compiler, "value", T_ID, ST_VARIABLE, TC_INT));
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "putinteger"), tmp, GLOBAL_DEPTH);
+
+    tmp = *init_symbol_with_id_symbol_type(compiler, "putfloat", T_ID, ST_PROCEDURE, TC_BOOL);
+    add_param(compiler, &tmp, *init_symbol_with_id_symbol_type(compiler, "value", T_ID, ST_VARIABLE, TC_FLOAT));
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "putfloat"), tmp, GLOBAL_DEPTH);
+
+    tmp = *init_symbol_with_id_symbol_type(compiler, "putstring", T_ID, ST_PROCEDURE, TC_BOOL);
+    add_param(compiler, &tmp, *init_symbol_with_id_symbol_type(compiler, "value", T_ID, ST_VARIABLE, TC_STRING));
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "putstring"), tmp, GLOBAL_DEPTH);
+
+    tmp = *init_symbol_with_id_symbol_type(compiler, "sqrt", T_ID, ST_PROCEDURE, TC_BOOL);
+    add_param(compiler, &tmp, *init_symbol_with_id_symbol_type(compiler, "value", T_ID, ST_VARIABLE, TC_INT));
+    set_symbol(sem->scopes, intern_cstr(&compiler->pool, "sqrt"), tmp, GLOBAL_DEPTH);
 
     return sem;
 }
@@ -74,13 +44,8 @@ void free_semantic_analyzer(Semantic* sem)
 {
     if (sem != NULL)
     {
-        if (sem->global != sem->current_local)
-        {
-            free_scope(sem->global);
-            sem->global = NULL;
-        }
-        free_scope(sem->current_local);
-        sem->current_local = NULL;
+        free_scope_stack(sem->scopes);
+        sem->scopes = NULL;
 
         free(sem);
         sem = NULL;
@@ -88,13 +53,11 @@ void free_semantic_analyzer(Semantic* sem)
 }
 
 /*
- * Enter and create a new local scope
+ * Enter a new local scope
  */
 void create_new_scope(Semantic* sem)
 {
-    Scope* new_scope = init_scope();
-    new_scope->prev_scope = sem->current_local;
-    sem->current_local = new_scope;
+    push_scope(sem->scopes);
 }
 
 /*
@@ -103,101 +66,57 @@ void create_new_scope(Semantic* sem)
  */
 void exit_current_scope(Semantic* sem)
 {
-    if (sem->current_local != NULL && sem->current_local != sem->global)
-    {
-        Scope* tmp = sem->current_local;
-        sem->current_local = sem->current_local->prev_scope;
-        free_scope(tmp);
-    }
+    pop_scope(sem->scopes);
 }
 
-void set_symbol_semantic(Semantic* sem, char* s, Symbol sym, bool is_global)
+void set_symbol_semantic(Semantic* sem, const InternedString* s, Symbol sym, bool is_global)
 {
-    if (is_global)
-    {
-        set_symbol(sem->global, s, sym);
-    }
-    else
-    {
-        set_symbol(sem->current_local, s, sym);
-    }
-}
-
-// Look for exisiting symbol first in local and global scope
-// If doesn't exist, set it
-// If does, update the current one from its scope
-void update_symbol_semantic_global(Semantic* sem, Symbol sym, bool is_global)
-{
-    if (sem != NULL)
-    {
-        if (!has_current_global_symbol(sem, sym.id, sym.is_global))
-        {
-            set_symbol_semantic(sem, sym.id, sym, sym.is_global);
-        }
-        else
-        {
-            if (is_global)
-            {
-                update_symbol(sem->global, sym.id, sym);
-            }
-            else
-            {
-                update_symbol(sem->current_local, sym.id, sym);
-            }
-        }
-    }
+    set_symbol(sem->scopes, s, sym, is_global ? GLOBAL_DEPTH : sem->scopes->depth);
 }
 
 /*
- * Travel upward and get symbol from either local scope or global
+ * Get symbol from either local scope or global
  */
-Symbol get_current_symbol(Semantic* sem, char* s)
+Symbol* get_current_symbol(Semantic* sem, const InternedString* s)
 {
-    if (has_symbol(sem->current_local, s))
-    {
-        return get_symbol(sem->current_local, s);
-    }
-    else
-    {
-        return get_symbol(sem->global, s);
-    }
+    return lookup_symbol(sem->scopes, s);
 }
 
 /*
- * Find symbol or return an unknown type symbol
+ * Find symbol in global scope or travel upward, NULL if it is not declared
  */
-Symbol get_current_global_symbol(Semantic* sem, char* s, bool is_global)
+Symbol* get_current_global_symbol(Semantic* sem, const InternedString* s, bool is_global)
 {
     if (is_global)
     {
-        return get_symbol(sem->global, s);
+        return get_symbol(sem->scopes, s, GLOBAL_DEPTH);
     }
     else
     {
-        return get_current_symbol(sem, s);
+        return lookup_symbol(sem->scopes, s);
     }
 }
 
 /*
  * Check local and global for symbol
  */
-bool has_current_symbol(Semantic* sem, char* s)
+bool has_current_symbol(Semantic* sem, const InternedString* s)
 {
-    return has_symbol(sem->current_local, s) || has_symbol(sem->global, s);
+    return lookup_symbol(sem->scopes, s) != NULL;
 }
 
 /*
  * Check global first for symbol
  */
-bool has_current_global_symbol(Semantic* sem, char* s, bool is_global)
+bool has_current_global_symbol(Semantic* sem, const InternedString* s, bool is_global)
 {
     if (is_global)
     {
-        return has_symbol(sem->global, s);
+        return has_symbol(sem->scopes, s, GLOBAL_DEPTH);
     }
     else
     {
-        return has_symbol(sem->current_local, s);
+        return has_symbol(sem->scopes, s, sem->scopes->depth);
     }
 }
 
@@ -205,122 +124,96 @@ void set_current_procedure(Semantic* sem, Symbol proc)
 {
     if (sem != NULL)
     {
-        if (has_current_symbol(sem, _CUR_PROC))
-        {
-            update_symbol(sem->current_local, _CUR_PROC, proc);
-        }
-        else
-        {
-            set_symbol(sem->current_local, _CUR_PROC, proc);
-        }
+        set_symbol(sem->scopes, sem->cur_proc_name, proc, sem->scopes->depth);
     }
 }
 
-Symbol get_current_procedure(Semantic* sem)
+Symbol* get_current_procedure(Semantic* sem)
 {
-    return get_symbol(sem->current_local, _CUR_PROC);
+    return get_symbol(sem->scopes, sem->cur_proc_name, sem->scopes->depth);
 }
 
 void print_scope(Semantic* sem, bool is_global)
 {
     if (is_global)
     {
-        print_symbol_table(sem->global);
+        print_symbol_table(sem->scopes, GLOBAL_DEPTH);
     }
     else
     {
-        print_symbol_table(sem->current_local);
+        print_symbol_table(sem->scopes, sem->scopes->depth);
     }
 }
 
 bool is_current_scope_global(Semantic* sem)
 {
-    return sem->global == sem->current_local;
-}
-
-TokenType check_for_reserved_word(Semantic* sem, char* str)
-{
-    if (has_current_global_symbol(sem, str, true))
-    {
-        Symbol tmp = get_current_global_symbol(sem, str, true);
-        return tmp.ttype;
-    }
-    return T_ID;
+    return sem->scopes->depth == GLOBAL_DEPTH;
 }
 
 void insert_runtime_functions(Semantic* sem)
 {
-    Symbol s;
-    char* str;
+    bp_compiler_T* compiler = sem->compiler;
+    Symbol* s;
+    const InternedString* key;
     LLVMValueRef func;
 
-    str = "getbool";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "getbool");
+    key = intern_cstr(&compiler->pool, "getbool");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "getbool");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 
-    str = "getinteger";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "getinteger");
+    key = intern_cstr(&compiler->pool, "getinteger");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "getinteger");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 
-    str = "getfloat";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "getfloat");
+    key = intern_cstr(&compiler->pool, "getfloat");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "getfloat");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
     
-    str = "getstring";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "getstring");
+    key = intern_cstr(&compiler->pool, "getstring");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "getstring");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 
-    str = "putbool";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "putbool");
+    key = intern_cstr(&compiler->pool, "putbool");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "putbool");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 
-    str = "putinteger";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "putinteger");
+    key = intern_cstr(&compiler->pool, "putinteger");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "putinteger");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 
-    str = "putfloat";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "putfloat");
+    key = intern_cstr(&compiler->pool, "putfloat");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "putfloat");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 
-    str = "putstring";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "putstring");
+    key = intern_cstr(&compiler->pool, "putstring");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "putstring");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 
-    str = "sqrt";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "_sqrt");
+    key = intern_cstr(&compiler->pool, "sqrt");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "_sqrt");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 
-    str = "_outOfBoundsError";
-    s = get_symbol(sem->global, str);
-    func = LLVMGetNamedFunction(llvm_module, "outOfBoundsError");
+    key = intern_cstr(&compiler->pool, "_outOfBoundsError");
+    s = get_symbol(sem->scopes, key, GLOBAL_DEPTH);
+    func = LLVMGetNamedFunction(compiler->module, "outOfBoundsError");
     LLVMSetLinkage(func, LLVMExternalLinkage);
-    s.llvm_function = func;
-    update_symbol(sem->global, str, s);
+    s->llvm_function = func;
 }
\ No newline at end of file
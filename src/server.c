@@ -0,0 +1,218 @@
+#include "include/server.h"
+#include "include/bp.h"
+#include "include/codegen.h"
+#include "include/compiler.h"
+#include "include/cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+
+static const char* serving_path;
+static pid_t serving_child;
+
+/*
+ * Answer the requests of one client until it disconnects
+ */
+static void* serve_connection(void* arg)
+{
+    int fd = (int) (intptr_t) arg;
+    ServerRequest request;
+    while (read_all(fd, &request, sizeof(request)))
+    {
+        if (request.magic != BP_SERVER_MAGIC || request.name_length > PATH_MAX || request.source_length > BP_SERVER_MAX_SOURCE)
+        {
+            break;
+        }
+
+        // The lexer expects the source to end with a '\0' sentinel
+        char* name = malloc(request.name_length + 1);
+        char* src = malloc(request.source_length + 1);
+        bool received = read_all(fd, name, request.name_length) && read_all(fd, src, request.source_length);
+        name[request.name_length] = '\0';
+        src[request.source_length] = '\0';
+
+        bool sent = false;
+        if (received)
+        {
+            char* bitcode = NULL;
+            size_t bitcode_length = 0;
+            char* diagnostics = NULL;
+            // Answered like bp.out would compile it without a server. Clients
+            // compile with -O or -march themselves, requests are -O0 generic.
+            bool status = compile_cached(src, request.source_length, name, false, NULL, NULL, &bitcode, &bitcode_length, &diagnostics);
+
+            ServerResponse response = { status, strlen(diagnostics), bitcode_length };
+            sent = write_all(fd, &response, sizeof(response))
+                && write_all(fd, diagnostics, response.diagnostics_length)
+                && write_all(fd, bitcode, response.bitcode_length);
+            free(diagnostics);
+            free(bitcode);
+        }
+
+        free(name);
+        free(src);
+        if (!sent)
+        {
+            break;
+        }
+    }
+
+    close(fd);
+    return NULL;
+}
+
+static void stop_serving(int signal)
+{
+    unlink(serving_path);
+    if (serving_child > 0)
+    {
+        kill(serving_child, SIGTERM);
+    }
+    _exit(0);
+}
+
+/*
+ * Accept clients on fd forever, each served on its own thread
+ */
+static void accept_clients(int fd)
+{
+    // Everything a compilation shares is set up before the first request
+    initialize_llvm();
+    load_runtime();
+
+    for (;;)
+    {
+        int client = accept(fd, NULL, NULL);
+        if (client < 0)
+        {
+            continue;
+        }
+
+        // Other users could read the results, or fill the cache
+        if (!peer_is_user(client))
+        {
+            close(client);
+            continue;
+        }
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve_connection, (void*) (intptr_t) client) != 0)
+        {
+            close(client);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+/*
+ * Create the directory of socket_path, readable only by the user, if it is
+ * missing. False if another user could replace the socket in it.
+ */
+static bool socket_directory(const char* socket_path)
+{
+    const char* slash = strrchr(socket_path, '/');
+    if (slash == NULL)
+    {
+        return true;
+    }
+
+    char* directory = strndup(socket_path, slash > socket_path ? slash - socket_path : 1);
+    struct stat info;
+    if (mkdir(directory, 0700) != 0 && errno != EEXIST)
+    {
+        printf("Could not create `%s`: %s\n", directory, strerror(errno));
+        free(directory);
+        return false;
+    }
+
+    // A sticky directory like /tmp only lets the owner of the socket remove it
+    bool safe = lstat(directory, &info) == 0 && S_ISDIR(info.st_mode)
+        && ((info.st_uid == getuid() && (info.st_mode & (S_IWGRP | S_IWOTH)) == 0) || (info.st_mode & S_ISVTX) != 0);
+    if (!safe)
+    {
+        printf("Not serving in `%s`, another user owns or can write to it\n", directory);
+    }
+    free(directory);
+    return safe;
+}
+
+/*
+ * Serve compile requests on socket_path until killed. The clients are
+ * served by a child process, restarted if a compilation crashes it.
+ */
+int bp_serve(const char* socket_path)
+{
+    struct sockaddr_un address;
+    if (!socket_address(socket_path, &address))
+    {
+        printf("Socket path `%s` is too long\n", socket_path);
+        return 1;
+    }
+
+    if (!socket_directory(socket_path))
+    {
+        return 1;
+    }
+
+    int running = connect_server(socket_path);
+    if (running >= 0)
+    {
+        close(running);
+        printf("A server is already running on `%s`\n", socket_path);
+        return 1;
+    }
+
+    // The socket of a server that is gone is replaced
+    unlink(socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        printf("Could not listen on `%s`: %s\n", socket_path, strerror(errno));
+        return 1;
+    }
+
+    serving_path = socket_path;
+    signal(SIGINT, stop_serving);
+    signal(SIGTERM, stop_serving);
+    printf("Serving on %s\n", socket_path);
+    fflush(stdout);
+
+    for (;;)
+    {
+        pid_t child = fork();
+        if (child == 0)
+        {
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            accept_clients(fd);
+        }
+        if (child < 0)
+        {
+            printf("Could not start the compile server: %s\n", strerror(errno));
+            unlink(socket_path);
+            return 1;
+        }
+
+        serving_child = child;
+        int status;
+        while (waitpid(child, &status, 0) < 0 && errno == EINTR)
+        {
+        }
+        printf("Compile server stopped (%s %d), restarting\n",
+            WIFSIGNALED(status) ? "signal" : "exit status",
+            WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status));
+        fflush(stdout);
+    }
+    return 0;
+}
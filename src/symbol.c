@@ -1,128 +1,70 @@
 #include "include/symbol.h"
+#include "include/error.h"
+#include <string.h>
 
-extern LLVMBuilderRef llvm_builder;
-extern LLVMModuleRef llvm_module;
-extern LLVMContextRef llvm_context;
+#define PARAMS_INITIAL_CAPACITY 4
 
-Symbol* init_symbol()
+Symbol* init_symbol_with_id_symbol_type(bp_compiler_T* compiler, char* id_name, TokenType token_type, SymbolType sym_type, TypeClass type_c)
 {
-    Symbol* sym = calloc(1, sizeof(struct Symbol));
-    sym->id = "";
-    sym->ttype = T_UNKNOWN;
-    sym->stype = ST_UNKOWN;
-    sym->type = TC_UNKNOWN;
-    sym->is_global = false;
-    sym->is_arr = false;
-    sym->arr_size = 0;
-    sym->is_indexed = false;
-    sym->is_not_empty = true;
-    sym->params = calloc(1, sizeof(struct SymbolNode));
-    sym->llvm_value = NULL;
-    sym->llvm_address = NULL;
-    sym->llvm_function = NULL;
-    return sym;
-}
-
-Symbol* init_symbol_with_id(char* id_name, TokenType token_type)
-{
-    Symbol* sym = calloc(1, sizeof(struct Symbol));
-    sym->id = id_name;
-    sym->ttype = token_type;
-    sym->stype = ST_UNKOWN;
-    sym->type = TC_UNKNOWN;
-    sym->is_global = false;
-    sym->is_arr = false;
-    sym->arr_size = 0;
-    sym->is_indexed = false;
-    sym->is_not_empty = true;
-    sym->params = calloc(1, sizeof(struct SymbolNode));
-    sym->llvm_value = NULL;
-    sym->llvm_address = NULL;
-    sym->llvm_function = NULL;
-    return sym;
-}
-Symbol* init_symbol_with_id_symbol_type(char* id_name, TokenType token_type, SymbolType sym_type, TypeClass type_c)
-{
-    Symbol* sym = calloc(1, sizeof(struct Symbol));
+    Symbol* sym = arena_alloc(compiler->symbol_arena, sizeof(struct Symbol));
     sym->id = id_name;
+    sym->name = intern_cstr(&compiler->pool, id_name);
     sym->ttype = token_type;
     sym->stype = sym_type;
     sym->type = type_c;
     sym->is_global = false;
     sym->is_arr = false;
     sym->arr_size = 0;
-    sym->is_indexed = false;
-    sym->is_not_empty = true;
-    sym->params = calloc(1, sizeof(struct SymbolNode));
-    sym->llvm_value = NULL;
+    sym->params = NULL;
     sym->llvm_address = NULL;
     sym->llvm_function = NULL;
     return sym;
 }
 
-/*
- * Take head SymbolNode of params
- * and then traverse the params linked list
- * until reach index node
- */
-Symbol get_nth_param(Symbol* sym, int idx)
+Symbol* init_symbol(bp_compiler_T* compiler)
 {
-    SymbolNode *ptr = sym->params;
-    int count = 0;
-    while (ptr !=NULL)
-    {
-        if (count == idx)
-        {
-            return ptr->symbol;
-        }
-        count++;
-        ptr = ptr->next_symbol;
-    }
+    return init_symbol_with_id_symbol_type(compiler, "", T_UNKNOWN, ST_UNKOWN, TC_UNKNOWN);
+}
 
-    // User ask for a non-existent element, fail.
-    assert(0);
+Symbol* init_symbol_with_id(bp_compiler_T* compiler, char* id_name, TokenType token_type)
+{
+    return init_symbol_with_id_symbol_type(compiler, id_name, token_type, ST_UNKOWN, TC_UNKNOWN);
 }
 
-int params_size(Symbol* sym)
+/*
+ * Append param, doubling the list when it is full.
+ * The old list stays in the arena, so the total is bounded by twice the final size.
+ */
+void add_param(bp_compiler_T* compiler, Symbol* sym, Symbol param)
 {
-    int count = 0;
-    SymbolNode *ptr = sym->params;
+    ParamList* params = sym->params;
 
-    while (ptr != NULL && ptr->symbol.is_not_empty)
+    if (params == NULL || params->count == params->capacity)
     {
-        ptr = ptr->next_symbol;
-        count += 1;
+        int capacity = params == NULL ? PARAMS_INITIAL_CAPACITY : params->capacity * 2;
+        ParamList* grown = arena_alloc(compiler->symbol_arena, sizeof(struct ParamList) + capacity * sizeof(Symbol));
+        if (params != NULL)
+        {
+            memcpy(grown->items, params->items, params->count * sizeof(Symbol));
+            grown->count = params->count;
+        }
+        grown->capacity = capacity;
+        sym->params = params = grown;
     }
 
-    return count;
+    params->items[params->count++] = param;
 }
 
-void free_symbol(Symbol* sym)
+Symbol* get_nth_param(Symbol* sym, int idx)
 {
-    if (sym != NULL)
-    {
-        if (sym->params != NULL)
-        {
-            free_params_list(sym->params);
-        }
-        free(sym->llvm_address);
-        free(sym->llvm_function);
-        free(sym->llvm_value);
-        free(sym);
-        sym = NULL;
-    }
+    // User ask for a non-existent element, fail.
+    assert(idx >= 0 && idx < params_size(sym));
+    return &sym->params->items[idx];
 }
 
-void free_params_list(SymbolNode* head)
+int params_size(Symbol* sym)
 {
-    SymbolNode* tmp = NULL;
-    
-    while (head != NULL)
-    {
-        tmp = head;
-        head = head->next_symbol;
-        free(tmp);
-    }
+    return sym->params == NULL ? 0 : sym->params->count;
 }
 
 char* print_symbol_type(SymbolType type)
@@ -157,21 +99,21 @@ char* print_type_class(TypeClass type)
     }
 }
 
-LLVMTypeRef create_llvm_type(TypeClass entry_type) {
+LLVMTypeRef create_llvm_type(bp_compiler_T* compiler, TypeClass entry_type) {
 	LLVMTypeRef type;
 	switch (entry_type) {
 		case TC_INT:
-            type = LLVMInt32TypeInContext(llvm_context); break;
+            type = LLVMInt32TypeInContext(compiler->context); break;
 		case TC_FLOAT:
-			type = LLVMFloatTypeInContext(llvm_context); break;
+			type = LLVMFloatTypeInContext(compiler->context); break;
 		case TC_STRING:
-			type = LLVMPointerType(LLVMInt8TypeInContext(llvm_context), 0); break;
+			type = LLVMPointerType(LLVMInt8TypeInContext(compiler->context), 0); break;
 		case TC_BOOL:
-			type = LLVMInt1TypeInContext(llvm_context); break;
+			type = LLVMInt1TypeInContext(compiler->context); break;
         case TC_VOID:
-            type = LLVMVoidTypeInContext(llvm_context); break;
+            type = LLVMVoidTypeInContext(compiler->context); break;
 		default:
-			printf("Invalid type\n");
+			report_diagnostic(compiler, "Invalid type\n");
             return NULL;
 	}
 	return type;
@@ -1,34 +1,100 @@
 #include "include/token.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <ctype.h>
 #include <stdio.h>
 
 /*
- * Token constructor
+ * Token constructor, resets a token slot for reuse
  */
-Token* init_token(TokenType type)
+Token* init_token(Token* token, TokenType type)
 {
-    Token* token = calloc(1, sizeof(Token));
+    memset(token, 0, sizeof(Token));
     token->type = type;
 
     return token;
 }
 
 /*
- * Convert all input into lowercase
+ * Reserved word recognition.
+ * Dispatches on length and first character, then confirms the candidate
+ * with a case insensitive compare, so the source text is never copied.
+ * Returns T_ID for anything that is not a reserved word.
  */
-void to_lower_case_str(char *p) {
-    for ( ; *p; ++p) *p = tolower(*p);
+TokenType lookup_reserved_word(const char* str, size_t length)
+{
+    #define MATCH(word, type) if (strncasecmp(str, word, length) == 0) return type
+
+    switch (length)
+    {
+        case 2:
+            MATCH("is", K_IS);
+            MATCH("if", K_IF);
+            break;
+        case 3:
+            switch (tolower((unsigned char) str[0]))
+            {
+                case 'e': MATCH("end", K_END); break;
+                case 'f': MATCH("for", K_FOR); break;
+                case 'n': MATCH("not", K_NOT); break;
+            }
+            break;
+        case 4:
+            switch (tolower((unsigned char) str[0]))
+            {
+                case 'b': MATCH("bool", K_BOOL); break;
+                case 'e': MATCH("else", K_ELSE); break;
+                case 't':
+                    MATCH("then", K_THEN);
+                    MATCH("true", K_TRUE);
+                    break;
+            }
+            break;
+        case 5:
+            switch (tolower((unsigned char) str[0]))
+            {
+                case 'b': MATCH("begin", K_BEGIN); break;
+                case 'f':
+                    MATCH("float", K_FLOAT);
+                    MATCH("false", K_FALSE);
+                    break;
+            }
+            break;
+        case 6:
+            switch (tolower((unsigned char) str[0]))
+            {
+                case 'g': MATCH("global", K_GLOBAL); break;
+                case 's': MATCH("string", K_STRING); break;
+                case 'r': MATCH("return", K_RETURN); break;
+            }
+            break;
+        case 7:
+            switch (tolower((unsigned char) str[0]))
+            {
+                case 'p': MATCH("program", K_PROGRAM); break;
+                case 'i': MATCH("integer", K_INT); break;
+            }
+            break;
+        case 8:
+            MATCH("variable", K_VARIABLE);
+            break;
+        case 9:
+            MATCH("procedure", K_PROCEDURE);
+            break;
+    }
+
+    #undef MATCH
+    return T_ID;
 }
 
 /*
- * String representation of token
+ * String representation of token, allocated, the caller frees it
  */
 char* print_token(Token* token)
 {
     switch(token->type) {
-        case T_UNKNOWN: return "";
+        case T_UNKNOWN: return concatf("");
         case T_EOF:
             return concatf("T_END_OF_FILE\n");
         case T_ASSIGNMENT:
@@ -50,7 +116,7 @@ char* print_token(Token* token)
         case T_STRING:
             return concatf("T_STRING: \"%s\"\n", token->value.stringVal);
         case T_ID:
-            return concatf("T_IDENTIFIER: %s\n", token->value.stringVal);
+            return concatf("T_IDENTIFIER: %s\n", token->value.idVal != NULL ? token->value.idVal->str : "");
         case T_COLON:
             return concatf("T_COLON: %s\n", ":");
         case T_SEMI_COLON:
@@ -120,6 +186,6 @@ char* print_token(Token* token)
         case K_VARIABLE:
             return concatf("K_VARIABLE: %s\n", "variable");
         default:
-            return "";
+            return concatf("");
     }
 }
\ No newline at end of file